@@ -0,0 +1,109 @@
+// File: BufferHeap.h
+// Author: Rowan Clark
+//
+// Description:
+// A single large buffer on the graphics card which is divided between many
+// meshes, so creating a mesh is an allocation from an OffsetAllocator and a
+// glBufferSubData rather than a new buffer object from the driver. The
+// buffer uses immutable storage where it is available (GL 4.4). The same
+// heap can hold both vertex and index data.
+//
+// Allocations are referred to by handles rather than offsets because
+// Defragment moves allocations to close the gaps between them; look the
+// offset up with GetOffset whenever it is needed.
+//
+// ---- Usage ----
+//
+//    GLW::BufferHeapObj heap = GLW::BufferHeap::Make(64 * 1024 * 1024);
+//    GLW::BufferHeap::Handle vertices = heap->Allocate(sizeof(data), 32, data);
+//    ...
+//    heap->Free(vertices);
+
+#ifndef _BUFFER_HEAP_H_
+#define _BUFFER_HEAP_H_
+
+#include <iostream>
+#include <memory>
+#include <vector>
+
+#include <glad/glad.h>
+
+#include "Capabilities.h"
+#include "CheckOpenGLError.h"
+#include "OffsetAllocator.h"
+
+namespace GLW
+{
+
+	class BufferHeap
+	{
+	public:
+		using Handle = uint32_t;
+		static const Handle InvalidHandle = 0xFFFFFFFF;
+
+		struct Stats
+		{
+			uint64_t capacity;
+			uint64_t usedBytes;
+			uint64_t freeBytes;
+			uint64_t largestFreeBlock;
+			uint32_t numAllocations;
+			uint32_t numFreeBlocks;
+			// 0 when all free space is one block, approaching 1 as it splinters
+			float fragmentation;
+		};
+
+		BufferHeap(uint64_t _capacity);
+		~BufferHeap();
+
+		BufferHeap(const BufferHeap&) = delete;
+		BufferHeap& operator=(const BufferHeap&) = delete;
+
+		using BufferHeapObj = std::unique_ptr<BufferHeap>;
+		static BufferHeapObj Make(uint64_t _capacity)
+		{
+			return std::make_unique<BufferHeap>(_capacity);
+		}
+
+		// Reserve _size bytes whose offset is a multiple of _alignment and optionally
+		// upload _data into them. Throws if the heap has no block large enough.
+		Handle Allocate(uint64_t _size, uint64_t _alignment, const void* _data = nullptr);
+		void Free(Handle _handle);
+
+		// Upload into part of an existing allocation
+		void Upload(Handle _handle, uint64_t _offset, uint64_t _size, const void* _data);
+
+		uint64_t GetOffset(Handle _handle) const;
+		uint64_t GetSize(Handle _handle) const;
+
+		GLuint GetBuffer() const { return buffer; }
+
+		// Move every allocation down to close the gaps between them. The buffer object
+		// stays the same so anything bound to it stays valid, only offsets change.
+		void Defragment();
+
+		Stats GetStats() const;
+
+	private:
+		struct Record
+		{
+			OffsetAllocator::Allocation allocation;
+			uint64_t size;
+			uint64_t alignment;
+			bool live;
+		};
+
+		GLuint buffer;
+		OffsetAllocator allocator;
+
+		std::vector<Record> records;
+		std::vector<Handle> freeHandles;
+
+		const Record& GetRecord(Handle _handle) const;
+	};
+
+	using BufferHeapObj = BufferHeap::BufferHeapObj;
+
+} // namespace GLW
+
+#endif // _BUFFER_HEAP_H_
@@ -0,0 +1,46 @@
+// File: Capabilities.h
+// Author: Rowan Clark
+//
+// Description:
+// Runtime checks for the optional OpenGL features GLW takes advantage of.
+// glad fills in its GLAD_GL_* flags when the context is loaded, so these
+// must only be called once a context is current. Each check accepts either
+// the core version which introduced the feature or the ARB extension.
+//
+// ---- Usage ----
+//
+//    if (GLW::Capabilities::DirectStateAccess())
+//    {
+//        glCreateBuffers(1, &buffer);
+//        glNamedBufferStorage(buffer, size, data, 0);
+//    }
+
+#ifndef _CAPABILITIES_H_
+#define _CAPABILITIES_H_
+
+#include <glad/glad.h>
+
+namespace GLW
+{
+
+	namespace Capabilities
+	{
+		// Immutable buffer storage, glBufferStorage (GL 4.4)
+		inline bool BufferStorage()
+		{
+			return GLAD_GL_VERSION_4_4 || GLAD_GL_ARB_buffer_storage;
+		}
+
+		// Editing objects without binding them, glCreate* and glNamed* (GL 4.5). Only
+		// reported when immutable buffer and texture storage come with it, since the
+		// DSA code paths always allocate immutable storage.
+		inline bool DirectStateAccess()
+		{
+			return GLAD_GL_VERSION_4_5
+				|| (GLAD_GL_ARB_direct_state_access && GLAD_GL_ARB_buffer_storage && GLAD_GL_ARB_texture_storage);
+		}
+	}
+
+} // namespace GLW
+
+#endif // _CAPABILITIES_H_
@@ -66,7 +66,7 @@ namespace GLW
 #ifdef _DEBUG
 	#define GL_CHECK(stmt) stmt; GLW::CheckOpenGLError(#stmt, __FILE__, __LINE__);
 #else
-	#define GL_CHECK(stmt) stmt; stmt;
+	#define GL_CHECK(stmt) stmt;
 #endif
 
 }
@@ -0,0 +1,74 @@
+// File: ComputeProgram.h
+// Author: Rowan Clark
+//
+// Description:
+// A shader program with a single compute shader stage (GL 4.3). Uniforms
+// and uniform/storage block bindings are set through the ShaderProgram
+// interface, and the program is run with Dispatch. Writes made by a
+// dispatch are only visible to later commands after a Barrier with the
+// bits matching how the data will next be read.
+//
+// ---- Usage ----
+//
+//    GLW::ComputeProgramObj program = GLW::ComputeProgram::Make("shaders/blur.comp");
+//    program->Use();
+//    program->SetUniform("radius", 4);
+//    program->Dispatch(width / 16, height / 16);
+//    GLW::ComputeProgram::Barrier(GL_TEXTURE_FETCH_BARRIER_BIT);
+
+#ifndef _COMPUTE_PROGRAM_H_
+#define _COMPUTE_PROGRAM_H_
+
+#include <memory>
+#include <string>
+
+#include <glad/glad.h>
+
+#include "CheckOpenGLError.h"
+#include "ShaderProgram.h"
+
+namespace GLW
+{
+
+	class ComputeProgram : public ShaderProgram
+	{
+	public:
+		// Compile and link a compute program from GLSL source text
+		ComputeProgram(const std::string& _source);
+		~ComputeProgram();
+
+		using ComputeProgramObj = std::unique_ptr<ComputeProgram>;
+		static ComputeProgramObj Make(const std::string& _computeShaderPath)
+		{
+			return std::make_unique<ComputeProgram>(LoadShaderFromFile(_computeShaderPath));
+		}
+		static ComputeProgramObj MakeFromSource(const std::string& _source)
+		{
+			return std::make_unique<ComputeProgram>(_source);
+		}
+
+		// Use the program and launch the given number of work groups
+		void Dispatch(GLuint _numGroupsX, GLuint _numGroupsY = 1, GLuint _numGroupsZ = 1);
+		// Use the program and launch with group counts read from the bound GL_DISPATCH_INDIRECT_BUFFER
+		void DispatchIndirect(GLintptr _offset = 0);
+
+		// Number of work groups needed to cover _numItems along x with the program's local size
+		GLuint GetNumGroups(GLuint _numItems) const;
+
+		// Make writes from earlier dispatches visible, e.g. GL_SHADER_STORAGE_BARRIER_BIT
+		// or GL_COMMAND_BARRIER_BIT before using results as indirect draw commands
+		static void Barrier(GLbitfield _barriers);
+
+		// True when the context supports compute shaders and storage buffers
+		static bool IsSupported();
+
+	private:
+		GLuint computeShader;
+		GLint localSize[3];
+	};
+
+	using ComputeProgramObj = ComputeProgram::ComputeProgramObj;
+
+} // namespace GLW
+
+#endif // _COMPUTE_PROGRAM_H_
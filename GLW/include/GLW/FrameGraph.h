@@ -0,0 +1,159 @@
+// File: FrameGraph.h
+// Author: Rowan Clark
+//
+// Description:
+// A frame graph describes one frame of rendering as a set of passes which
+// declare the render targets they read and write. Compiling the graph
+//   - culls passes whose outputs are never read or presented,
+//   - orders the remaining passes so every target is written before it is read,
+//   - works out the lifetime of each transient target so targets with the
+//     same format and size alias one another through a RenderTargetPool.
+// Executing the graph binds a framebuffer for each pass and invalidates
+// attachments whose contents are not needed before or after the pass.
+//
+// The graph is rebuilt every frame, the pool and framebuffer cache persist
+// between frames so steady state rendering does no allocation on the GPU.
+//
+// ---- Usage ----
+//
+//    GLW::FrameGraph graph;
+//    auto scene = graph.CreateTarget("scene", GL_RGBA16F, 1280, 720);
+//    auto depth = graph.CreateTarget("depth", GL_DEPTH_COMPONENT24, 1280, 720);
+//    auto backbuffer = graph.ImportBackbuffer("backbuffer", 1280, 720);
+//
+//    graph.AddPass("scene", {}, { scene, depth }, [&](GLW::FrameGraph&) { ... draw scene ... });
+//    graph.AddPass("tonemap", { scene }, { backbuffer }, [&](GLW::FrameGraph& _graph)
+//    {
+//        _graph.BindTexture(scene);
+//        ... draw fullscreen triangle ...
+//    });
+//
+//    graph.Compile();
+//    graph.Execute();
+//    graph.Reset();
+
+#ifndef _FRAME_GRAPH_H_
+#define _FRAME_GRAPH_H_
+
+#include <functional>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <glad/glad.h>
+
+#include "CheckOpenGLError.h"
+#include "Framebuffer.h"
+#include "RenderTargetPool.h"
+
+namespace GLW
+{
+
+	class FrameGraph
+	{
+	public:
+		using ResourceHandle = int;
+		using PassCallback = std::function<void(FrameGraph&)>;
+
+		FrameGraph();
+		~FrameGraph();
+
+		// Declare a transient render target which only lives for this frame
+		ResourceHandle CreateTarget(const std::string& _name, GLenum _internalFormat, int _width, int _height);
+
+		// Declare the default framebuffer. Passes writing to it are never culled.
+		ResourceHandle ImportBackbuffer(const std::string& _name, int _width, int _height);
+
+		// Keep the passes producing _resource alive even if nothing reads it. The
+		// target stays acquired after Execute so it can be read until Reset.
+		void MarkOutput(ResourceHandle _resource);
+
+		// Add a pass which samples from _reads and renders into _writes.
+		// A pass may not write to both the backbuffer and transient targets.
+		void AddPass(const std::string& _name,
+			const std::vector<ResourceHandle>& _reads,
+			const std::vector<ResourceHandle>& _writes,
+			PassCallback _execute);
+
+		// Cull, sort and allocate the passes added this frame
+		void Compile();
+
+		// Run every pass that survived compilation in dependency order
+		void Execute();
+
+		// Remove all passes and resources ready for the next frame, returning
+		// outputs to the pool. Pooled targets and cached framebuffers are kept.
+		void Reset();
+
+		// Only valid while the resource is alive during Execute, or for outputs
+		// between Execute and Reset
+		GLuint GetTexture(ResourceHandle _resource);
+		// Bind the texture of _resource to the active texture unit
+		void BindTexture(ResourceHandle _resource);
+
+		// Passes in execution order after Compile, culled passes are omitted
+		std::vector<std::string> GetExecutionOrder() const;
+
+		// Delete pooled targets which are not acquired, along with the framebuffers using them
+		void Trim();
+
+		// For statistics, trim through the frame graph so its framebuffer cache stays valid
+		const RenderTargetPool& GetPool() const { return pool; }
+
+	private:
+		struct Resource
+		{
+			std::string name;
+			RenderTargetDesc desc;
+			bool imported;
+			bool output;
+
+			// Filled in by Compile
+			int refCount;
+			int firstUse;
+			int lastUse;
+
+			// Only set while the resource is alive during Execute, outputs keep
+			// theirs until Reset
+			RenderTarget* target;
+		};
+
+		struct Pass
+		{
+			std::string name;
+			std::vector<ResourceHandle> reads;
+			std::vector<ResourceHandle> writes;
+			PassCallback execute;
+
+			int refCount;
+			bool culled;
+		};
+
+		std::vector<Resource> resources;
+		std::vector<Pass> passes;
+		std::vector<int> executionOrder;
+		bool compiled;
+
+		RenderTargetPool pool;
+
+		// Framebuffers are keyed by the textures attached to them so pooled
+		// targets keep hitting the same framebuffer each frame
+		std::map<std::vector<GLuint>, FramebufferObj> framebufferCache;
+
+		void CheckHandle(ResourceHandle _resource) const;
+		void ReleaseTargets();
+		void CullPasses();
+		void SortPasses();
+		void ComputeLifetimes();
+
+		// Returns nullptr when the pass renders to the backbuffer
+		Framebuffer* BindPassFramebuffer(const Pass& _pass);
+		std::vector<GLenum> GetAttachments(const Pass& _pass, int _orderIndex, bool _atStart);
+		void EvictFramebuffers(const std::vector<GLuint>& _textures);
+	};
+
+} // namespace GLW
+
+#endif // _FRAME_GRAPH_H_
@@ -0,0 +1,122 @@
+// File: Framebuffer.h
+// Author: Rowan Clark
+//
+// Description:
+// This file encapsulates the OpenGL objects needed to render somewhere
+// other than the default framebuffer. A RenderTarget is a single level
+// texture which can be attached to a framebuffer and later sampled from
+// a shader. A Framebuffer is a Framebuffer Object with any number of
+// texture or renderbuffer attachments.
+//
+// ---- Usage ----
+//
+//    GLW::FramebufferObj framebuffer = GLW::Framebuffer::Make();
+//    framebuffer->AttachTarget(GL_COLOR_ATTACHMENT0, GLW::RenderTarget::Make(GL_RGBA8, 1280, 720));
+//    framebuffer->AttachRenderbuffer(GL_DEPTH_ATTACHMENT, GL_DEPTH_COMPONENT24, 1280, 720);
+//    framebuffer->CheckComplete();
+//    framebuffer->Bind();
+
+#ifndef _FRAMEBUFFER_H_
+#define _FRAMEBUFFER_H_
+
+#include <algorithm>
+#include <iostream>
+#include <memory>
+#include <vector>
+
+#include <glad/glad.h>
+
+#include "CheckOpenGLError.h"
+
+namespace GLW
+{
+
+	class RenderTarget
+	{
+	public:
+		RenderTarget(GLenum _internalFormat, int _width, int _height);
+		~RenderTarget();
+
+		using RenderTargetObj = std::unique_ptr<RenderTarget>;
+		static RenderTargetObj Make(GLenum _internalFormat, int _width, int _height)
+		{
+			return std::make_unique<RenderTarget>(_internalFormat, _width, _height);
+		}
+
+		// Bind the target to the active texture unit so it can be sampled
+		void Bind();
+
+		GLuint GetTexture() const { return texture; }
+		GLenum GetInternalFormat() const { return internalFormat; }
+		int GetWidth() const { return width; }
+		int GetHeight() const { return height; }
+
+		// True for depth and depth-stencil formats
+		static bool IsDepthFormat(GLenum _internalFormat);
+		// The attachment point a texture of this format is bound to, colour formats use _colorIndex
+		static GLenum GetAttachmentPoint(GLenum _internalFormat, unsigned int _colorIndex);
+
+	private:
+		GLuint texture;
+		GLenum internalFormat;
+		int width, height;
+	};
+
+	using RenderTargetObj = RenderTarget::RenderTargetObj;
+
+	class Framebuffer
+	{
+	public:
+		Framebuffer();
+		~Framebuffer();
+
+		using FramebufferObj = std::unique_ptr<Framebuffer>;
+		static FramebufferObj Make()
+		{
+			return std::make_unique<Framebuffer>();
+		}
+
+		// Attach a texture owned by someone else (e.g. a pooled render target)
+		void AttachTexture(GLenum _attachment, GLuint _texture, int _width, int _height);
+		// Attach a render target and take ownership of it
+		void AttachTarget(GLenum _attachment, RenderTargetObj _target);
+		// Attach a renderbuffer owned by the framebuffer. Use this for attachments
+		// which are written but never sampled, such as a depth buffer.
+		void AttachRenderbuffer(GLenum _attachment, GLenum _internalFormat, int _width, int _height);
+
+		// Throws if the attachments do not form a complete framebuffer
+		void CheckComplete();
+
+		// Bind for drawing, enabling every colour attachment as a draw buffer
+		void Bind();
+		// Bind the default (window) framebuffer
+		static void BindDefault();
+
+		// Tell the driver the contents of these attachments are no longer needed,
+		// which lets it skip loading or storing them. Leaves the framebuffer bound.
+		void Invalidate(const std::vector<GLenum>& _attachments);
+
+		// The texture attached at _attachment, or 0 for renderbuffers and empty attachments
+		GLuint GetTexture(GLenum _attachment) const;
+
+		int GetWidth() const { return width; }
+		int GetHeight() const { return height; }
+
+	private:
+		GLuint fbo;
+
+		int width, height;
+
+		std::vector<GLenum> drawBuffers;
+		std::vector<std::pair<GLenum, GLuint>> textures;
+		std::vector<RenderTargetObj> ownedTargets;
+		std::vector<GLuint> renderbuffers;
+
+		void TrackAttachment(GLenum _attachment, int _width, int _height);
+	};
+
+	using FramebufferObj = Framebuffer::FramebufferObj;
+
+} // namespace GLW
+
+#endif // _FRAMEBUFFER_H_
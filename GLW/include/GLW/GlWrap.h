@@ -8,6 +8,7 @@
 #define _GLWRAP_H_
 
 // Standard library includes
+#include <algorithm>
 #include <iostream>
 #include <map>
 #include <string>
@@ -25,9 +26,24 @@
 
 // Project includes
 #include "AttributeLayout.h"
+#include "BufferHeap.h"
+#include "Capabilities.h"
 #include "CheckOpenGLError.h"
+#include "ComputeProgram.h"
+#include "FrameGraph.h"
+#include "Framebuffer.h"
+#include "GpuCulling.h"
+#include "MeshFile.h"
+#include "PixelReadback.h"
+#include "ReadbackEncoder.h"
 #include "ShaderProgram.h"
+#include "ShaderStorageBuffer.h"
+#include "SpriteBatch.h"
+#include "StreamingBuffer.h"
+#include "TraceWriter.h"
+#include "TransformHierarchy.h"
 #include "VertexArray.h"
+#include "VertexFormat.h"
 
 namespace GLW
 {
@@ -41,16 +57,49 @@ namespace GLW
 		// 
 		void SetClearColor(float _red, float _green, float _blue, float _alpha);
 		void ClearFramebuffer();
+		void SetViewport(int _x, int _y, int _width, int _height);
+
+		/*********************************
+		************* Trace **************
+		*********************************/
+		// Record every following successful GlWrap call to a trace file which TracePlayer can replay.
+		// Start before creating any resources, a trace cannot refer to ones made earlier.
+		void StartTrace(const std::string& _tracePath, size_t _bufferSize = 16 * 1024 * 1024);
+		// Finish writing the trace and close it
+		void StopTrace();
+		bool IsTracing() const { return traceWriter != nullptr; }
+		// Mark the end of a frame in the trace, call once per frame. Does nothing when not tracing.
+		void MarkFrame();
+
+		/*********************************
+		********** Framebuffer ***********
+		*********************************/
+		// Create a framebuffer with a texture for each colour format and an optional
+		// depth renderbuffer (pass GL_NONE for no depth) which can be referenced by a key string
+		void CreateFramebuffer(const std::string& _framebufferKey, int _width, int _height,
+			const std::vector<GLenum>& _colorFormats, GLenum _depthFormat = GL_DEPTH_COMPONENT24);
+		// Render into the framebuffer, this also sets the viewport to cover it
+		void BindFramebuffer(const std::string& _framebufferKey);
+		// Render into the window again
+		void BindDefaultFramebuffer(int _width, int _height);
+		// Bind a colour attachment of a framebuffer to the active texture unit to sample it
+		void SetActiveFramebufferTexture(const std::string& _framebufferKey, unsigned int _colorIndex = 0);
 
 		/*********************************
 		************* Texture ************
 		*********************************/
-		// Generate a texture from an image file which can be referenced by a texture key string
-		void LoadTexture(const std::string& _textureKey, const std::string& _imagePath);
+		// Generate a texture from an image file which can be referenced by a texture key string.
+		// Storage matches the image's channel count; set _sRGB for colour images authored in sRGB.
+		void LoadTexture(const std::string& _textureKey, const std::string& _imagePath, bool _sRGB = false);
+		// Generate a texture from tightly packed 8 bit pixels with 1 to 4 channels, bottom row first
+		void CreateTexture(const std::string& _textureKey, int _width, int _height, int _channels,
+			const unsigned char* _pixels, bool _sRGB = false);
 		// Set texture to be used for draw calls
 		void SetActiveTexture(const std::string& _textureKey);
 		// Used to send multiple textures to a shader program
 		void SetTextureUnit(int _unit);
+		// OpenGL name of a texture, e.g. for SpriteBatch::Sprite
+		GLuint GetTexture(const std::string& _textureKey) const;
 
 		/*********************************
 		********** Vertex Array **********
@@ -60,23 +109,74 @@ namespace GLW
 			const std::vector<float>& _vertices,
 			const std::vector<unsigned int>& _elements,
 			const AttributeLayout& _attributeLayout);
+		// Create a vertex array from memory owned by the caller, _numVertexValues is the number of floats
+		void CreateVertexArray(const std::string& _vertexArrayKey,
+			const float* _vertices, size_t _numVertexValues,
+			const unsigned int* _elements, size_t _numElements,
+			const AttributeLayout& _attributeLayout);
+		// Create a vertex array whose data is sub-allocated from a buffer heap
+		void CreateVertexArray(const std::string& _vertexArrayKey,
+			const std::vector<float>& _vertices,
+			const std::vector<unsigned int>& _elements,
+			const AttributeLayout& _attributeLayout,
+			const std::string& _bufferHeapKey);
+		// Create a vertex array from one level of detail of a binary mesh file
+		void LoadMesh(const std::string& _vertexArrayKey, const std::string& _meshPath, size_t _lod = 0);
 
 		void BindVertexArray(const std::string& _vertexArrayKey);
+		// Call after binding a vertex array outside of GlWrap, e.g. drawing a SpriteBatch
+		void ForgetVertexArrayBinding();
 
 		void RenderVertexArray(const std::string& _vertexArrayKey);
 
+		/*********************************
+		********** Buffer Heap ***********
+		*********************************/
+		// Reserve one large buffer which many vertex arrays can share
+		void CreateBufferHeap(const std::string& _bufferHeapKey, uint64_t _capacity);
+		// Close the gaps left by deleted vertex arrays
+		void DefragmentBufferHeap(const std::string& _bufferHeapKey);
+		BufferHeap::Stats GetBufferHeapStats(const std::string& _bufferHeapKey);
+
 		/*********************************
 		********* Uniform Buffer *********
 		*********************************/
 		void CreateUniformBuffer(const std::string& _uniformBufferName, unsigned int _size, std::vector<std::string> _shaderKeys);
 
 		void SetUniformBuffer(const std::string& _uniformBufferName, unsigned int _offset, glm::mat4 _value);
+		void SetUniformBuffer(const std::string& _uniformBufferName, unsigned int _offset, unsigned int _size, const void* _data);
+		// Write _viewProjection * world for every transform as a mat4 array starting at _offset.
+		// The matrices go through a fenced staging ring and are copied into the buffer on the GPU,
+		// so neither side waits for the other. Call _transforms.Update() first.
+		void SetUniformBuffer(const std::string& _uniformBufferName, unsigned int _offset,
+			TransformHierarchy& _transforms, const glm::mat4& _viewProjection);
+
+		/*********************************
+		********* Storage Buffer *********
+		*********************************/
+		// Create a storage buffer of _size bytes which can be referenced by a key string
+		void CreateStorageBuffer(const std::string& _storageBufferKey, unsigned int _size, const void* _data = nullptr);
+		void SetStorageBuffer(const std::string& _storageBufferKey, unsigned int _offset, unsigned int _size, const void* _data);
+		// As SetUniformBuffer for transforms, e.g. for per-instance matrices read with gl_InstanceID
+		void SetStorageBuffer(const std::string& _storageBufferKey, unsigned int _offset,
+			TransformHierarchy& _transforms, const glm::mat4& _viewProjection);
+		// Attach the storage buffer to the binding point of a shader storage block
+		void BindStorageBuffer(const std::string& _storageBufferKey, unsigned int _bindingPoint);
 
 		/**************************
 		********* Shader **********
 		**************************/
 		void CreateShader(const std::string& _shaderKey, const std::string& _vertPath, const std::string& _fragPath);
+		void CreateShaderFromSource(const std::string& _shaderKey, const std::string& _vertSource, const std::string& _fragSource);
+		// Compute shaders share keys and uniforms with the other shaders
+		void CreateComputeShader(const std::string& _shaderKey, const std::string& _computePath);
+		void CreateComputeShaderFromSource(const std::string& _shaderKey, const std::string& _computeSource);
+		void DispatchCompute(const std::string& _shaderKey, unsigned int _numGroupsX, unsigned int _numGroupsY = 1, unsigned int _numGroupsZ = 1);
+		// Make the writes of earlier dispatches visible, e.g. GL_SHADER_STORAGE_BARRIER_BIT
+		void InsertMemoryBarrier(GLbitfield _barriers);
 		void UseShader(const std::string& _shaderKey);
+		// Vertex arrays whose layouts resolve to the same attribute locations share one vertex format
+		// where separate attribute formats are supported (GL 4.3), so this is cheap to call per mesh
 		void SpecifyAttributeLayout(const std::string& _shaderKey, const std::string& _vertexArryObjectKey);
 
 		void SetUniform(const std::string& _shaderKey, const std::string& _uniformKey, const int& _value);
@@ -86,11 +186,27 @@ namespace GLW
 		void SetUniform(const std::string& _shaderKey, const std::string& _uniformKey, const glm::mat4& _value);
 
 	private:
+		// The buffer behind a uniform buffer key, throwing unless _size bytes at _offset fit in it
+		GLuint FindUniformBuffer(const std::string& _uniformBufferName, unsigned int _offset, unsigned int _size) const;
+		void UploadTransforms(GLuint _buffer, unsigned int _offset, TransformHierarchy& _transforms, const glm::mat4& _viewProjection);
 
 		std::map <const std::string, GLuint> textureMap;
 		std::map <const std::string, ShaderProgramObj> shaderMap;
+		// Shared by vertex arrays with the same layout, so it must outlive them
+		VertexFormatCache vertexFormatCache;
+		// Declared before the vertex arrays so heaps outlive the vertex arrays allocated from them
+		std::map <const std::string, BufferHeapObj> bufferHeapMap;
 		std::map <const std::string, VertexArrayObj> vertexArrayMap;
-		std::map <const std::string, GLuint> uniformBufferMap;
+		// Buffer name and size in bytes, so writes can be checked against the end of the buffer
+		std::map <const std::string, std::pair<GLuint, unsigned int>> uniformBufferMap;
+		std::map <const std::string, ShaderStorageBufferObj> storageBufferMap;
+		std::map <const std::string, FramebufferObj> framebufferMap;
+
+		// Staging for the TransformHierarchy uploads, created on first use and grown to fit
+		StreamingBufferObj transformStaging;
+
+		// Only set while tracing
+		TraceWriterObj traceWriter;
 	};
 
 } // namespace GLW
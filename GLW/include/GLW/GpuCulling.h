@@ -0,0 +1,140 @@
+// File: GpuCulling.h
+// Author: Rowan Clark
+//
+// Description:
+// Moves per-instance visibility testing onto the graphics card. Each instance
+// is a bounding sphere and the index of the mesh it draws. A compute pass
+// tests every sphere against the camera frustum and appends a
+// DrawElementsIndirectCommand for each visible one to a storage buffer,
+// which Draw then hands to glMultiDrawElementsIndirect without the CPU ever
+// seeing the result. With GL 4.6 (or ARB_indirect_parameters) the number of
+// draws is also read from the GPU; otherwise every command slot is submitted
+// and the unused ones draw zero instances.
+//
+// All meshes must be sub-allocated from the same vertex and index BufferHeaps
+// with the same attribute layout so one vertex array can draw any of them.
+// Each command's baseInstance is the instance's index, so a vertex shader can
+// find its per-instance data with gl_BaseInstance (gl_BaseInstanceARB with
+// the extension), which needs GL 4.6 or ARB_shader_draw_parameters.
+//
+// ---- Usage ----
+//
+//    GLW::GpuCullingObj culling = GLW::GpuCulling::Make(100000);
+//    culling->SetMeshes({ rock.get(), tree.get() });
+//    culling->SetInstances(instances.data(), instances.size());
+//
+//    // Each frame
+//    culling->Cull(projection * view);
+//    shader->Use();
+//    culling->Draw();
+
+#ifndef _GPU_CULLING_H_
+#define _GPU_CULLING_H_
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include "CheckOpenGLError.h"
+#include "ComputeProgram.h"
+#include "ShaderStorageBuffer.h"
+#include "VertexArray.h"
+
+namespace GLW
+{
+
+	class GpuCulling
+	{
+	public:
+		// Matches the std430 layout of the instance block in the culling shader
+		struct Instance
+		{
+			glm::vec4 boundingSphere; // xyz centre, w radius, in world space
+			uint32_t mesh;            // index into the meshes passed to SetMeshes
+			uint32_t padding[3];
+		};
+
+		// Storage block binding points used by the culling shader
+		static const GLuint InstanceBinding = 0;
+		static const GLuint MeshBinding = 1;
+		static const GLuint CommandBinding = 2;
+		static const GLuint ParameterBinding = 3;
+
+		GpuCulling(uint32_t _maxInstances);
+		~GpuCulling();
+
+		GpuCulling(const GpuCulling&) = delete;
+		GpuCulling& operator=(const GpuCulling&) = delete;
+
+		using GpuCullingObj = std::unique_ptr<GpuCulling>;
+		static GpuCullingObj Make(uint32_t _maxInstances)
+		{
+			return std::make_unique<GpuCulling>(_maxInstances);
+		}
+
+		// The vertex arrays must be heap allocated from one vertex heap and one index heap
+		// and outlive this object. Throws if the list shrinks while an instance uses a dropped mesh.
+		// Call again after defragmenting the heap since it moves the meshes.
+		void SetMeshes(const std::vector<VertexArray*>& _meshes);
+		// Replace every instance, the meshes they refer to must already be set
+		void SetInstances(const Instance* _instances, uint32_t _numInstances);
+		// Update a range of instances in place, e.g. ones which moved this frame
+		void UpdateInstances(uint32_t _first, const Instance* _instances, uint32_t _numInstances);
+
+		// Run the culling pass against the frustum of a view projection matrix
+		void Cull(const glm::mat4& _viewProjection);
+		// Draw the visible instances with the currently bound shader
+		void Draw();
+
+		// Bind to read per-instance data in the vertex shader
+		const ShaderStorageBuffer& GetInstanceBuffer() const { return *instanceBuffer; }
+		uint32_t GetNumInstances() const { return numInstances; }
+
+		// Read back how many instances survived the last Cull. This stalls until the
+		// GPU has finished so it is only intended for debugging and statistics.
+		uint32_t ReadVisibleCount() const;
+
+	private:
+		// Matches DrawElementsIndirectCommand in the GL specification
+		struct DrawCommand
+		{
+			GLuint count;
+			GLuint instanceCount;
+			GLuint firstIndex;
+			GLint baseVertex;
+			GLuint baseInstance;
+		};
+
+		struct MeshInfo
+		{
+			GLuint count;
+			GLuint firstIndex;
+			GLint baseVertex;
+			GLuint padding;
+		};
+
+		uint32_t maxInstances;
+		uint32_t numInstances;
+
+		ComputeProgramObj program;
+		ShaderStorageBufferObj instanceBuffer;
+		ShaderStorageBufferObj meshBuffer;
+		ShaderStorageBufferObj commandBuffer;
+		ShaderStorageBufferObj parameterBuffer;
+
+		std::vector<VertexArray*> meshes;
+		// Mesh index of every instance slot, so SetMeshes can check a shorter list against them
+		std::vector<uint32_t> instanceMeshes;
+
+		// Whether the draw count can be sourced from parameterBuffer
+		bool indirectCount;
+	};
+
+	using GpuCullingObj = GpuCulling::GpuCullingObj;
+
+} // namespace GLW
+
+#endif // _GPU_CULLING_H_
@@ -0,0 +1,56 @@
+// File: MappedFile.h
+// Author: Rowan Clark
+//
+// Description:
+// A read only memory mapping of a whole file. The operating system pages
+// the file in on demand, so data can be handed straight to OpenGL from the
+// mapping without first being read into a heap buffer.
+
+#ifndef _MAPPED_FILE_H_
+#define _MAPPED_FILE_H_
+
+#include <cstddef>
+#include <iostream>
+#include <memory>
+#include <string>
+
+namespace GLW
+{
+
+	class MappedFile
+	{
+	public:
+		MappedFile(const std::string& _path);
+		~MappedFile();
+
+		MappedFile(const MappedFile&) = delete;
+		MappedFile& operator=(const MappedFile&) = delete;
+
+		using MappedFileObj = std::unique_ptr<MappedFile>;
+		static MappedFileObj Make(const std::string& _path)
+		{
+			return std::make_unique<MappedFile>(_path);
+		}
+
+		const unsigned char* GetData() const { return data; }
+		size_t GetSize() const { return size; }
+		const std::string& GetPath() const { return path; }
+
+	private:
+		std::string path;
+		const unsigned char* data;
+		size_t size;
+
+#ifdef _WIN32
+		void* file;
+		void* mapping;
+#else
+		int file;
+#endif
+	};
+
+	using MappedFileObj = MappedFile::MappedFileObj;
+
+} // namespace GLW
+
+#endif // _MAPPED_FILE_H_
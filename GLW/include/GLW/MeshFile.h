@@ -0,0 +1,149 @@
+// File: MeshFile.h
+// Author: Rowan Clark
+//
+// Description:
+// A versioned binary container for meshes which can be memory mapped and
+// uploaded to the graphics card without any parsing or copying. A file holds
+//   - a header with the format version, vertex stride and bounding box,
+//   - the attribute layout of the vertex data,
+//   - a table of levels of detail, each with its own vertex and index blob.
+// Every blob starts on a BlobAlignment byte boundary so the mapped pointers
+// can be handed straight to OpenGL. Files are little endian.
+//
+// Mesh files are produced offline by the MeshConverter tool or MeshFile::Write.
+//
+// ---- Usage ----
+//
+//    GLW::MeshFileObj mesh = GLW::MeshFile::Make("models/teapot.glwm");
+//    GLW::VertexArrayObj vertexArray = mesh->CreateVertexArray(0);
+
+#ifndef _MESH_FILE_H_
+#define _MESH_FILE_H_
+
+#include <cstdint>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "AttributeLayout.h"
+#include "MappedFile.h"
+
+namespace GLW
+{
+
+	// Only needed by CreateVertexArray, so offline tools can read and write mesh files without OpenGL
+	class VertexArray;
+
+	namespace MeshFormat
+	{
+		const uint32_t Magic = 0x4D574C47; // "GLWM"
+		const uint32_t Version = 1;
+		const uint64_t BlobAlignment = 16;
+		const size_t MaxAttributeNameLength = 32;
+
+		struct Header
+		{
+			uint32_t magic;
+			uint32_t version;
+			uint32_t numAttributes;
+			uint32_t numLods;
+			// Floats per vertex, the sum of the attribute sizes
+			uint32_t vertexStride;
+			uint32_t reserved;
+			float boundsMin[3];
+			float boundsMax[3];
+			uint64_t attributeTableOffset;
+			uint64_t lodTableOffset;
+		};
+
+		struct Attribute
+		{
+			// Null terminated
+			char name[MaxAttributeNameLength];
+			uint32_t numValues;
+			uint32_t reserved;
+		};
+
+		struct Lod
+		{
+			uint64_t vertexOffset;
+			uint64_t numVertices;
+			uint64_t indexOffset;
+			uint64_t numIndices;
+			// Error of this level relative to the full detail mesh, 0 for the first level
+			float error;
+			uint32_t reserved;
+		};
+
+		static_assert(sizeof(Header) == 64, "Mesh file header must be packed");
+		static_assert(sizeof(Attribute) == 40, "Mesh file attribute must be packed");
+		static_assert(sizeof(Lod) == 40, "Mesh file lod must be packed");
+	}
+
+	// A level of detail pointing into the mapped file
+	struct MeshLodView
+	{
+		const float* vertices;
+		size_t numVertices;
+		const unsigned int* indices;
+		size_t numIndices;
+		float error;
+	};
+
+	// A level of detail held in memory, used when writing mesh files
+	struct MeshLodData
+	{
+		std::vector<float> vertices;
+		std::vector<unsigned int> indices;
+		float error;
+	};
+
+	class MeshFile
+	{
+	public:
+		// Map and validate a mesh file, throws if the file is malformed or from a newer version
+		MeshFile(const std::string& _path);
+		~MeshFile();
+
+		using MeshFileObj = std::unique_ptr<MeshFile>;
+		static MeshFileObj Make(const std::string& _path)
+		{
+			return std::make_unique<MeshFile>(_path);
+		}
+
+		const AttributeLayout& GetAttributeLayout() const { return attributeLayout; }
+		// Number of floats in each vertex
+		uint32_t GetVertexStride() const { return header->vertexStride; }
+		glm::vec3 GetBoundsMin() const;
+		glm::vec3 GetBoundsMax() const;
+
+		size_t GetNumLods() const { return lods.size(); }
+		const MeshLodView& GetLod(size_t _lod) const;
+
+		// Upload a level of detail directly from the mapping, include VertexArray.h to use the result
+		std::unique_ptr<VertexArray> CreateVertexArray(size_t _lod = 0) const;
+
+		static void Write(const std::string& _path,
+			const AttributeLayout& _attributeLayout,
+			const glm::vec3& _boundsMin, const glm::vec3& _boundsMax,
+			const std::vector<MeshLodData>& _lods);
+
+	private:
+		MappedFileObj file;
+		const MeshFormat::Header* header;
+
+		AttributeLayout attributeLayout;
+		std::vector<MeshLodView> lods;
+
+		// Throws unless [_offset, _offset + _size) lies inside the file
+		void CheckRange(uint64_t _offset, uint64_t _size, const char* _what) const;
+	};
+
+	using MeshFileObj = MeshFile::MeshFileObj;
+
+} // namespace GLW
+
+#endif // _MESH_FILE_H_
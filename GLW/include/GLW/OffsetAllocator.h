@@ -0,0 +1,109 @@
+// File: OffsetAllocator.h
+// Author: Rowan Clark
+//
+// Description:
+// A Two-Level Segregated Fit (TLSF) allocator which hands out offsets into a
+// range of a fixed size rather than memory itself, so it can manage space in
+// a buffer that lives on the graphics card. Free blocks are kept in bins
+// indexed by the position of their highest set bit and the next few bits
+// below it, and two levels of bitmaps find a bin large enough for a request
+// in constant time. Freed blocks are merged with free neighbours so space is
+// reused instead of fragmenting.
+//
+// ---- Usage ----
+//
+//    GLW::OffsetAllocator allocator(64 * 1024 * 1024);
+//    GLW::OffsetAllocator::Allocation allocation = allocator.Allocate(1024, 16);
+//    ... use the range [allocation.offset, allocation.offset + 1024) ...
+//    allocator.Free(allocation);
+
+#ifndef _OFFSET_ALLOCATOR_H_
+#define _OFFSET_ALLOCATOR_H_
+
+#include <cstdint>
+#include <vector>
+
+namespace GLW
+{
+
+	class OffsetAllocator
+	{
+	public:
+		static const uint32_t NoSpace = 0xFFFFFFFF;
+
+		struct Allocation
+		{
+			// Aligned offset of the allocation
+			uint64_t offset;
+			// Identifies the block for Free, NoSpace if the allocation failed
+			uint32_t node;
+		};
+
+		struct Stats
+		{
+			uint64_t capacity;
+			uint64_t usedBytes;
+			uint64_t freeBytes;
+			uint64_t largestFreeBlock;
+			uint32_t numAllocations;
+			uint32_t numFreeBlocks;
+		};
+
+		OffsetAllocator(uint64_t _capacity);
+		~OffsetAllocator();
+
+		// Returns an allocation with node == NoSpace if no free block is large enough.
+		// _alignment need not be a power of two, e.g. it can be a vertex stride. Exactly
+		// _size bytes are used, padding skipped to align the offset stays free.
+		Allocation Allocate(uint64_t _size, uint64_t _alignment = 1);
+		void Free(const Allocation& _allocation);
+
+		// Free everything, leaving a single free block covering the whole range
+		void Reset();
+
+		Stats GetStats() const;
+		uint64_t GetCapacity() const { return capacity; }
+
+	private:
+		static const uint32_t SecondLevelLog2 = 3;
+		static const uint32_t SecondLevelCount = 1 << SecondLevelLog2;
+		static const uint32_t FirstLevelCount = 64 - SecondLevelLog2 + 1;
+
+		struct Node
+		{
+			uint64_t offset;
+			uint64_t size;
+			// Neighbours in the free list of the bin, only valid while free
+			uint32_t binPrev, binNext;
+			// Neighbours in address order
+			uint32_t neighbourPrev, neighbourNext;
+			bool used;
+		};
+
+		uint64_t capacity;
+
+		std::vector<Node> nodes;
+		std::vector<uint32_t> unusedNodes;
+
+		uint64_t firstLevelBitmap;
+		uint8_t secondLevelBitmaps[FirstLevelCount];
+		uint32_t binHeads[FirstLevelCount * SecondLevelCount];
+
+		uint32_t numAllocations;
+		uint64_t usedBytes;
+
+		static uint64_t AlignUp(uint64_t _offset, uint64_t _alignment);
+		static void Mapping(uint64_t _size, uint32_t& _firstLevel, uint32_t& _secondLevel);
+		bool FindBin(uint64_t _size, uint32_t& _firstLevel, uint32_t& _secondLevel) const;
+
+		uint32_t CreateNode(uint64_t _offset, uint64_t _size);
+		// Shrink _node to _size and return a new node for the rest of it, neither is in a free list
+		uint32_t Split(uint32_t _node, uint64_t _size);
+		void InsertFree(uint32_t _node);
+		void RemoveFree(uint32_t _node);
+		void ReleaseNode(uint32_t _node);
+	};
+
+} // namespace GLW
+
+#endif // _OFFSET_ALLOCATOR_H_
@@ -0,0 +1,113 @@
+// File: PixelReadback.h
+// Author: Rowan Clark
+//
+// Description:
+// Asynchronous readback of framebuffer contents to the CPU. Each Read issues
+// glReadPixels into one of a ring of Pixel Buffer Objects and places a fence
+// after it, so the call returns immediately instead of stalling until the GPU
+// has finished rendering. Poll should be called once a frame on the thread
+// owning the context; it checks the fences without blocking and hands each
+// completed read to its consumer while the buffer is mapped.
+//
+// The callback form is zero-copy: the pointer handed to the callback is the
+// mapped buffer itself and is only valid until the callback returns. The future
+// form copies the pixels out and is fulfilled by Poll or Flush, so do not wait
+// on the future from the rendering thread before calling one of them.
+//
+// ---- Usage ----
+//
+//    GLW::PixelReadbackObj readback = GLW::PixelReadback::Make();
+//
+//    // every frame, after rendering
+//    readback->Read(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE,
+//        [](const unsigned char* _pixels, const GLW::ReadbackInfo& _info) { ... });
+//    readback->Poll();
+//
+//    // before shutdown
+//    readback->Flush();
+
+#ifndef _PIXEL_READBACK_H_
+#define _PIXEL_READBACK_H_
+
+#include <functional>
+#include <future>
+#include <iostream>
+#include <memory>
+#include <vector>
+
+#include <glad/glad.h>
+
+#include "CheckOpenGLError.h"
+
+namespace GLW
+{
+
+	struct ReadbackInfo
+	{
+		int x, y, width, height;
+		GLenum format, type;
+		// Size of the pixel data in bytes, rows are tightly packed and bottom row first
+		size_t size;
+		// Sequence number of the read, counting from zero
+		unsigned long long index;
+	};
+
+	class PixelReadback
+	{
+	public:
+		using ReadbackCallback = std::function<void(const unsigned char* _pixels, const ReadbackInfo& _info)>;
+
+		// _numBuffers reads can be in flight before Read has to wait on the oldest.
+		// Use at least as many buffers as frames the GPU may lag behind the CPU.
+		PixelReadback(unsigned int _numBuffers = 3);
+		~PixelReadback();
+
+		using PixelReadbackObj = std::unique_ptr<PixelReadback>;
+		static PixelReadbackObj Make(unsigned int _numBuffers = 3)
+		{
+			return std::make_unique<PixelReadback>(_numBuffers);
+		}
+
+		// Queue a read of the bound read framebuffer, _callback is called from Poll or Flush
+		// and must not queue further reads itself. The area must not be empty.
+		void Read(int _x, int _y, int _width, int _height, GLenum _format, GLenum _type, ReadbackCallback _callback);
+		// Queue a read whose pixels are copied into the returned future
+		std::future<std::vector<unsigned char>> Read(int _x, int _y, int _width, int _height, GLenum _format, GLenum _type);
+
+		// Deliver every read the GPU has finished without blocking
+		void Poll();
+		// Block until every queued read has been delivered
+		void Flush();
+
+		size_t GetNumPending() const { return numPending; }
+		// Number of times Read had to block because every buffer was in flight
+		unsigned long long GetNumStalls() const { return numStalls; }
+
+		static size_t GetBytesPerPixel(GLenum _format, GLenum _type);
+
+	private:
+		struct Slot
+		{
+			GLuint buffer;
+			size_t capacity;
+			GLsync fence;
+			ReadbackInfo info;
+			ReadbackCallback callback;
+		};
+
+		std::vector<Slot> slots;
+		size_t head;
+		size_t numPending;
+
+		unsigned long long numReads;
+		unsigned long long numStalls;
+
+		// Returns true if the oldest read was delivered
+		bool Complete(GLuint64 _timeout);
+	};
+
+	using PixelReadbackObj = PixelReadback::PixelReadbackObj;
+
+} // namespace GLW
+
+#endif // _PIXEL_READBACK_H_
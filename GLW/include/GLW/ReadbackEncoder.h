@@ -0,0 +1,92 @@
+// File: ReadbackEncoder.h
+// Author: Rowan Clark
+//
+// Description:
+// A worker thread which writes pixels read back by PixelReadback to disk,
+// either as raw bytes or encoded as PNG, so that encoding and file IO never
+// block the rendering thread. The queue is bounded: if the worker falls
+// behind, Submit blocks rather than letting memory grow without limit.
+//
+// ---- Usage ----
+//
+//    GLW::ReadbackEncoder encoder(GLW::ReadbackEncoder::Encoding::Png);
+//    readback->Read(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, encoder.MakeCallback("frames/frame_"));
+//    ...
+//    readback->Flush();
+//    encoder.Wait();
+
+#ifndef _READBACK_ENCODER_H_
+#define _READBACK_ENCODER_H_
+
+#include <condition_variable>
+#include <deque>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "PixelReadback.h"
+
+namespace GLW
+{
+
+	class ReadbackEncoder
+	{
+	public:
+		enum class Encoding
+		{
+			Raw,
+			Png
+		};
+
+		ReadbackEncoder(Encoding _encoding, size_t _maxQueuedFrames = 8);
+		~ReadbackEncoder();
+
+		ReadbackEncoder(const ReadbackEncoder&) = delete;
+		ReadbackEncoder& operator=(const ReadbackEncoder&) = delete;
+
+		// Queue pixels to be written to _path. Pixel rows are bottom row first as
+		// returned by glReadPixels, PNG output is flipped to be top row first.
+		void Submit(std::vector<unsigned char> _pixels, const ReadbackInfo& _info, const std::string& _path);
+
+		// A readback callback which copies the mapped pixels and submits them to
+		// be written to _pathPrefix followed by the read index and an extension
+		PixelReadback::ReadbackCallback MakeCallback(const std::string& _pathPrefix);
+
+		// Block until every submitted frame has been written
+		void Wait();
+
+		// Frames which could not be encoded or written, errors are also logged to std::cerr
+		unsigned long long GetNumFailures();
+
+	private:
+		struct Job
+		{
+			std::vector<unsigned char> pixels;
+			ReadbackInfo info;
+			std::string path;
+		};
+
+		Encoding encoding;
+		size_t maxQueuedFrames;
+
+		std::deque<Job> jobs;
+		bool busy;
+		bool stopping;
+		unsigned long long numFailures;
+
+		std::mutex mutex;
+		std::condition_variable jobAdded;
+		std::condition_variable jobTaken;
+		std::condition_variable idle;
+
+		std::thread worker;
+
+		void Run();
+		bool Encode(Job& _job);
+	};
+
+} // namespace GLW
+
+#endif // _READBACK_ENCODER_H_
@@ -0,0 +1,92 @@
+// File: RenderTargetPool.h
+// Author: Rowan Clark
+//
+// Description:
+// A pool of transient render targets keyed by internal format and size.
+// Targets released back to the pool are handed out again to the next
+// request with a matching description, so a post processing chain
+// allocates its textures once instead of every frame. Targets which go
+// unused for a number of frames are deleted.
+//
+// ---- Usage ----
+//
+//    GLW::RenderTargetPool pool;
+//    GLW::RenderTarget* target = pool.Acquire({ GL_RGBA16F, 1280, 720 });
+//    ... render to and sample from target ...
+//    pool.Release(target);
+//    pool.EndFrame();
+
+#ifndef _RENDER_TARGET_POOL_H_
+#define _RENDER_TARGET_POOL_H_
+
+#include <map>
+#include <tuple>
+#include <vector>
+
+#include <glad/glad.h>
+
+#include "Framebuffer.h"
+
+namespace GLW
+{
+
+	struct RenderTargetDesc
+	{
+		GLenum internalFormat;
+		int width;
+		int height;
+
+		bool operator<(const RenderTargetDesc& _other) const
+		{
+			return std::tie(internalFormat, width, height) < std::tie(_other.internalFormat, _other.width, _other.height);
+		}
+
+		bool operator==(const RenderTargetDesc& _other) const
+		{
+			return internalFormat == _other.internalFormat && width == _other.width && height == _other.height;
+		}
+	};
+
+	class RenderTargetPool
+	{
+	public:
+		// Targets not acquired for _maxIdleFrames calls to EndFrame are deleted
+		RenderTargetPool(unsigned int _maxIdleFrames = 8);
+		~RenderTargetPool();
+
+		// Return a free target matching _desc, creating one if none is free
+		RenderTarget* Acquire(const RenderTargetDesc& _desc);
+
+		// Return a target to the pool so it can be reused by a later Acquire
+		void Release(RenderTarget* _target);
+
+		// Advance the frame counter and delete targets that have been idle too long.
+		// The textures of deleted targets are appended to _evicted if given so that
+		// anything caching them (such as framebuffers) can be invalidated.
+		void EndFrame(std::vector<GLuint>* _evicted = nullptr);
+
+		// Delete every target which is not currently acquired
+		void Trim(std::vector<GLuint>* _evicted = nullptr);
+
+		size_t GetNumTargets() const;
+		size_t GetNumTargetsInUse() const;
+
+	private:
+		struct Entry
+		{
+			RenderTargetObj target;
+			bool inUse;
+			unsigned int lastUsedFrame;
+		};
+
+		std::map<RenderTargetDesc, std::vector<Entry>> entryMap;
+
+		unsigned int frame;
+		unsigned int maxIdleFrames;
+
+		void Evict(unsigned int _maxIdleFrames, std::vector<GLuint>* _evicted);
+	};
+
+} // namespace GLW
+
+#endif // _RENDER_TARGET_POOL_H_
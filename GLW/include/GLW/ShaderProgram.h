@@ -25,13 +25,21 @@ namespace GLW
     {
     public:
         ShaderProgram(const std::string& _vertexShaderPath, const std::string& _fragmentShaderPath);
-        ~ShaderProgram();
+        virtual ~ShaderProgram();
 
         using ShaderProgramObj = std::unique_ptr <ShaderProgram>;
         static ShaderProgramObj Make(const std::string& _vertexShaderPath, const std::string& _fragmentShaderPath)
         {
             return std::make_unique< ShaderProgram>(_vertexShaderPath, _fragmentShaderPath);
         }
+        static ShaderProgramObj MakeFromSource(const std::string& _vertexSource, const std::string& _fragmentSource)
+        {
+            ShaderProgramObj shaderProgram(new ShaderProgram());
+            shaderProgram->Link(_vertexSource, _fragmentSource);
+            return shaderProgram;
+        }
+
+        static std::string LoadShaderFromFile(const std::string& _filePath);
 
         void Use();
 
@@ -41,11 +49,19 @@ namespace GLW
         void SetUniform(const std::string& _uniformKey, const glm::vec4& _value);
         void SetUniform(const std::string& _uniformKey, const glm::mat4& _value);
 
+        // Applies to the bound vertex array and GL_ARRAY_BUFFER, VertexArray::SpecifyAttributeLayout
+        // does not depend on what is bound
         void SpecifyAttributeLayout(const AttributeLayout& _attributeLayout);
+        // -1 if the shader has no active attribute with that name. Locations are
+        // resolved once when the program is linked so this makes no GL calls.
+        GLint GetAttributeLocation(const std::string& _attributeName) const;
 
         void BindToUniformBlock(const std::string& _uniformBlockName, unsigned int _bindingPoint);
+        void BindToStorageBlock(const std::string& _storageBlockName, unsigned int _bindingPoint);
 
     protected:
+        // Used by derived programs which attach their own shader stages
+        ShaderProgram();
 
         GLuint shaderProgram;
 
@@ -54,10 +70,14 @@ namespace GLW
 
         std::map <const std::string, GLuint> uniformMap;
         std::map <const std::string, GLuint> uniformBlockMap;
-
-        std::string LoadShaderFromFile(const std::string& _filePath);
+        std::map <const std::string, GLint> attributeLocationMap;
 
         void CompileShader(GLuint& _shader, GLenum _shaderType, const std::string& _source);
+        // Compile, attach and link a vertex and fragment shader pair
+        void Link(const std::string& _vertexSource, const std::string& _fragmentSource);
+
+        // Fill the attribute location map from the active attributes of the linked program
+        void ResolveAttributeLocations();
     };
 
     using ShaderProgramObj = ShaderProgram::ShaderProgramObj;
@@ -0,0 +1,70 @@
+// File: ShaderStorageBuffer.h
+// Author: Rowan Clark
+//
+// Description:
+// A fixed size buffer which shaders can read and write as a storage block
+// (GL 4.3). Unlike a uniform block it may be as large as the card allows and
+// compute shaders can write into it, so it is how data is passed between
+// compute passes and draws. Storage is immutable where it is available.
+//
+// ---- Usage ----
+//
+//    GLW::ShaderStorageBufferObj particles = GLW::ShaderStorageBuffer::Make(sizeof(Particle) * count, data);
+//    particles->BindBase(0);            // layout(std430, binding = 0) buffer Particles { ... };
+//    simulate->Dispatch(simulate->GetNumGroups(count));
+//    GLW::ComputeProgram::Barrier(GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT);
+
+#ifndef _SHADER_STORAGE_BUFFER_H_
+#define _SHADER_STORAGE_BUFFER_H_
+
+#include <iostream>
+#include <memory>
+
+#include <glad/glad.h>
+
+#include "Capabilities.h"
+#include "CheckOpenGLError.h"
+
+namespace GLW
+{
+
+	class ShaderStorageBuffer
+	{
+	public:
+		ShaderStorageBuffer(GLsizeiptr _size, const void* _data = nullptr);
+		~ShaderStorageBuffer();
+
+		ShaderStorageBuffer(const ShaderStorageBuffer&) = delete;
+		ShaderStorageBuffer& operator=(const ShaderStorageBuffer&) = delete;
+
+		using ShaderStorageBufferObj = std::unique_ptr<ShaderStorageBuffer>;
+		static ShaderStorageBufferObj Make(GLsizeiptr _size, const void* _data = nullptr)
+		{
+			return std::make_unique<ShaderStorageBuffer>(_size, _data);
+		}
+
+		// Replace part of the buffer's contents, throws if the range overruns the buffer
+		void Upload(GLintptr _offset, GLsizeiptr _size, const void* _data);
+		// Read part of the buffer back, this waits for the GPU so keep it out of the frame loop
+		void Download(GLintptr _offset, GLsizeiptr _size, void* _data) const;
+		// Set every 32 bit word in the buffer to _value
+		void Clear(GLuint _value = 0);
+
+		// Attach the whole buffer to an indexed storage block binding point
+		void BindBase(GLuint _bindingPoint) const;
+		// Bind to a non indexed target, e.g. GL_DRAW_INDIRECT_BUFFER or GL_PARAMETER_BUFFER
+		void Bind(GLenum _target) const;
+
+		GLuint GetBuffer() const { return buffer; }
+		GLsizeiptr GetSize() const { return size; }
+
+	private:
+		GLuint buffer;
+		GLsizeiptr size;
+	};
+
+	using ShaderStorageBufferObj = ShaderStorageBuffer::ShaderStorageBufferObj;
+
+} // namespace GLW
+
+#endif // _SHADER_STORAGE_BUFFER_H_
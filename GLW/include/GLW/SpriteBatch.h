@@ -0,0 +1,149 @@
+// File: SpriteBatch.h
+// Author: Rowan Clark
+//
+// Description:
+// Draws large numbers of textured 2D quads (UI, overlays, particles) in a
+// handful of draw calls. Sprites are collected between Begin and End, then
+// grouped by texture so each draw can sample from up to MaxTextureSlots
+// textures, and the corners of every quad are computed on the CPU with SSE2
+// (falling back to scalar code elsewhere).
+//
+// Vertices are written into a StreamingBuffer and drawn from it directly, so
+// a region is only rewritten once the GPU has finished the draws reading it.
+// Every draw shares one static index buffer holding two triangles per quad.
+// If more sprites are drawn in a frame than fit in a region, the sprites so
+// far are flushed and a new region started.
+//
+// The batch uses its own shader and vertex array, binds textures to units 0
+// to MaxTextureSlots - 1 and leaves unit 0 active. Depth testing and blending
+// are left to the caller; colours are multiplied with the texture, so the
+// usual choice is glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA).
+// Meshes drawn through a VertexFormatCache afterwards need its ForgetBinding
+// called first, since End leaves the batch's vertex array bound.
+//
+// ---- Usage ----
+//
+//    GLW::SpriteBatchObj sprites = GLW::SpriteBatch::Make();
+//
+//    // Each frame
+//    sprites->Begin(glm::ortho(0.0f, width, 0.0f, height));
+//    for (const auto& icon : icons)
+//    {
+//        sprites->Draw({ icon.position, icon.size, icon.angle, glm::vec4(0, 0, 1, 1), glm::vec4(1), atlasTexture });
+//    }
+//    sprites->End();
+
+#ifndef _SPRITE_BATCH_H_
+#define _SPRITE_BATCH_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include "Capabilities.h"
+#include "CheckOpenGLError.h"
+#include "ShaderProgram.h"
+#include "StreamingBuffer.h"
+
+namespace GLW
+{
+
+	class SpriteBatch
+	{
+	public:
+		struct Sprite
+		{
+			glm::vec2 position; // centre of the quad
+			glm::vec2 size;     // full width and height
+			float rotation;     // anticlockwise about the centre, in radians
+			glm::vec4 uvRect;   // u0, v0, u1, v1 mapped to the bottom left and top right corners
+			glm::vec4 color;    // multiplied with the texture, components in [0, 1]
+			GLuint texture;     // GL_TEXTURE_2D name, e.g. from GlWrap::GetTexture
+		};
+
+		enum class SortMode
+		{
+			// Group sprites by texture. Sprites sharing a texture keep their order, but
+			// overlapping sprites with different textures may be drawn out of order.
+			Texture,
+			// Draw in the order submitted, starting a new draw whenever a batch runs
+			// out of texture slots. Use for overlapping translucent sprites.
+			Submission
+		};
+
+		// Textures one draw call can sample from
+		static const unsigned int MaxTextureSlots = 8;
+
+		// _maxSprites is the number of sprites a region holds and _numRegions the number
+		// of frames the GPU may lag behind before Begin has to wait for it
+		SpriteBatch(uint32_t _maxSprites = 65536, unsigned int _numRegions = 3);
+		~SpriteBatch();
+
+		SpriteBatch(const SpriteBatch&) = delete;
+		SpriteBatch& operator=(const SpriteBatch&) = delete;
+
+		using SpriteBatchObj = std::unique_ptr<SpriteBatch>;
+		static SpriteBatchObj Make(uint32_t _maxSprites = 65536, unsigned int _numRegions = 3)
+		{
+			return std::make_unique<SpriteBatch>(_maxSprites, _numRegions);
+		}
+
+		// Start collecting sprites which will be drawn with _viewProjection
+		void Begin(const glm::mat4& _viewProjection, SortMode _sortMode = SortMode::Texture);
+		void Draw(const Sprite& _sprite);
+		void Draw(const Sprite* _sprites, size_t _numSprites);
+		// Draw every sprite collected since Begin
+		void End();
+
+		// Statistics for the last frame, reset by Begin
+		uint32_t GetNumSprites() const { return numSpritesDrawn; }
+		uint32_t GetNumDrawCalls() const { return numDrawCalls; }
+		// Number of times a region was still in use by the GPU when it was needed
+		unsigned long long GetNumStalls() const { return vertexStream->GetNumStalls(); }
+
+	private:
+		// 24 bytes, the layout matches the attribute locations in the sprite shader
+		struct Vertex
+		{
+			float x, y;
+			float u, v;
+			uint32_t color; // RGBA8, normalised
+			uint32_t slot;  // texture slot within the draw
+		};
+
+		uint32_t maxSprites;
+
+		// Each region holds the quads of maxSprites sprites
+		StreamingBufferObj vertexStream;
+		GLuint vao;
+		GLuint indexBuffer;
+		GLenum indexType;
+		ShaderProgramObj shader;
+
+		bool drawing;
+		SortMode sortMode;
+		// Texture bound to each slot's unit since Begin, 0 if not yet bound
+		GLuint boundTextures[MaxTextureSlots];
+		std::vector<Sprite> sprites;
+		// Texture name in the upper 32 bits and submission index in the lower
+		std::vector<uint64_t> sortKeys;
+
+		uint32_t numSpritesDrawn;
+		uint32_t numDrawCalls;
+
+		// Draw the collected sprites and clear them
+		void Flush();
+
+		// Write the four corners of each sprite, _slots gives each sprite's texture slot
+		static void WriteQuads(const Sprite* const* _sprites, const uint32_t* _slots, size_t _numSprites, Vertex* _vertices);
+	};
+
+	using SpriteBatchObj = SpriteBatch::SpriteBatchObj;
+
+} // namespace GLW
+
+#endif // _SPRITE_BATCH_H_
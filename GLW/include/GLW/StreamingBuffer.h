@@ -0,0 +1,109 @@
+// File: StreamingBuffer.h
+// Author: Rowan Clark
+//
+// Description:
+// A buffer for data rewritten every frame. It is either drawn from directly
+// (e.g. SpriteBatch's vertices) or used as staging for transform matrices
+// which are then copied into a uniform or storage buffer on the GPU. Writing
+// into the destination directly would have the driver wait for draws still
+// reading its previous contents; the copy is queued behind them instead.
+//
+// The buffer is split into regions, with a fence after the draws or copies
+// reading each region so it is only rewritten once the GPU has finished with it.
+// With GL 4.4 (or ARB_buffer_storage) the buffer stays persistently mapped;
+// otherwise each write is mapped unsynchronised. Writes are packed into the
+// current region until one does not fit, which moves on to the next region.
+//
+// ---- Usage ----
+//
+//    GLW::StreamingBufferObj staging = GLW::StreamingBuffer::Make(count * sizeof(glm::mat4));
+//
+//    // Each frame
+//    transforms.WriteMatrices(staging->Map(count * sizeof(glm::mat4)), sizeof(glm::mat4), viewProjection);
+//    staging->Copy(uniformBuffer, 0);
+//
+//    // Or draw straight from the buffer, which a vertex array can source vertices from
+//    WriteVertices(stream->Map(numVertices * sizeof(Vertex)));
+//    stream->Unmap();
+//    glDrawArrays(GL_TRIANGLES, static_cast<GLint>(stream->GetMappedOffset() / sizeof(Vertex)), numVertices);
+
+#ifndef _STREAMING_BUFFER_H_
+#define _STREAMING_BUFFER_H_
+
+#include <iostream>
+#include <memory>
+#include <vector>
+
+#include <glad/glad.h>
+
+#include "Capabilities.h"
+#include "CheckOpenGLError.h"
+
+namespace GLW
+{
+
+	class StreamingBuffer
+	{
+	public:
+		// _regionSize is the most that can be written at once and _numRegions the number
+		// of regions the GPU may lag behind before Map has to wait for it
+		StreamingBuffer(GLsizeiptr _regionSize, unsigned int _numRegions = 3);
+		~StreamingBuffer();
+
+		StreamingBuffer(const StreamingBuffer&) = delete;
+		StreamingBuffer& operator=(const StreamingBuffer&) = delete;
+
+		using StreamingBufferObj = std::unique_ptr<StreamingBuffer>;
+		static StreamingBufferObj Make(GLsizeiptr _regionSize, unsigned int _numRegions = 3)
+		{
+			return std::make_unique<StreamingBuffer>(_regionSize, _numRegions);
+		}
+
+		// Space for _size bytes the GPU is no longer reading, valid until Unmap or Copy.
+		// Write sequentially since the memory may be write combined. Writes start on a
+		// 16 byte boundary.
+		void* Map(GLsizeiptr _size);
+		// Finish writing so the GPU can read the bytes written since Map
+		void Unmap();
+		// Unmap and queue a copy of the bytes written since Map into _buffer at _offset
+		void Copy(GLuint _buffer, GLintptr _offset);
+		// Start the next Map in a fresh region, e.g. once a frame so a frame never waits
+		// on the one the GPU is still drawing. Does nothing if the region is unused.
+		void NextRegion();
+
+		GLuint GetBuffer() const { return buffer; }
+		// Offset in bytes of the last Map within the buffer
+		GLintptr GetMappedOffset() const { return mappedOffset; }
+		GLsizeiptr GetRegionSize() const { return regionSize; }
+		// Number of times a region was still in use by the GPU when it was needed
+		unsigned long long GetNumStalls() const { return numStalls; }
+
+	private:
+		GLuint buffer;
+		GLsizeiptr regionSize;
+
+		// One per region, set once the draws and copies reading from the region have been issued
+		std::vector<GLsync> regionFences;
+		unsigned int currentRegion;
+		// Bytes of the current region already handed out
+		GLsizeiptr regionOffset;
+
+		// Whole buffer when persistently mapped, otherwise null
+		unsigned char* persistentData;
+
+		// Range returned by the last Map
+		GLintptr mappedOffset;
+		GLsizeiptr mappedSize;
+		bool mapped;
+
+		unsigned long long numStalls;
+
+		// Move to the next region, waiting for the GPU if it is still reading from it
+		void AdvanceRegion();
+	};
+
+	using StreamingBufferObj = StreamingBuffer::StreamingBufferObj;
+
+} // namespace GLW
+
+#endif // _STREAMING_BUFFER_H_
@@ -0,0 +1,85 @@
+// File: TraceFormat.h
+// Author: Rowan Clark
+//
+// Description:
+// The layout of a GLW trace file, written by TraceWriter while GlWrap is
+// capturing and read back by TracePlayer. A trace starts with a Header and
+// is followed by records, each a one byte Command and then its arguments
+// with no padding. Arguments are written in the host's byte order:
+//
+//   Value  - a fixed size integer or float
+//   String - a 32 bit id for a key string. The first time an id appears
+//            NewStringBit is set and the id is followed by a 32 bit length
+//            and the characters, later uses are just the id.
+//   Text   - a 32 bit length and the characters, for long one-off strings
+//            such as shader source
+//   Blob   - a 64 bit size in bytes and the bytes
+//   Layout - a 32 bit attribute count, then a String and 32 bit value
+//            count for each attribute
+
+#ifndef _TRACE_FORMAT_H_
+#define _TRACE_FORMAT_H_
+
+#include <cstdint>
+
+namespace GLW
+{
+
+	namespace TraceFormat
+	{
+		const uint32_t Magic = 0x54574C47; // "GLWT"
+		const uint32_t Version = 1;
+		const uint32_t NewStringBit = 0x80000000;
+
+		struct Header
+		{
+			uint32_t magic;
+			uint32_t version;
+		};
+
+		// Arguments are listed in the order they are written
+		enum class Command : uint8_t
+		{
+			EndFrame,                    //
+			SetClearColor,               // float red, green, blue, alpha
+			ClearFramebuffer,            //
+			SetViewport,                 // int32 x, y, width, height
+			CreateFramebuffer,           // String key, int32 width, height, uint32 count, count x uint32 colour format, uint32 depth format
+			BindFramebuffer,             // String key
+			BindDefaultFramebuffer,      // int32 width, height
+			SetActiveFramebufferTexture, // String key, uint32 colour index
+			CreateTexture,               // String key, int32 width, height, channels, uint8 sRGB, Blob pixels
+			SetActiveTexture,            // String key
+			SetTextureUnit,              // int32 unit
+			CreateVertexArray,           // String key, Blob vertices, Blob indices, Layout
+			CreateHeapVertexArray,       // String key, Blob vertices, Blob indices, Layout, String heap key
+			BindVertexArray,             // String key
+			RenderVertexArray,           // String key
+			CreateBufferHeap,            // String key, uint64 capacity
+			DefragmentBufferHeap,        // String key
+			CreateUniformBuffer,         // String name, uint32 size, uint32 count, count x String shader key
+			SetUniformBuffer,            // String name, uint32 offset, 16 x float
+			CreateStorageBuffer,         // String key, uint32 size, Blob data (empty for none)
+			SetStorageBuffer,            // String key, uint32 offset, Blob data
+			BindStorageBuffer,           // String key, uint32 binding point
+			CreateShader,                // String key, Text vertex source, Text fragment source
+			CreateComputeShader,         // String key, Text source
+			UseShader,                   // String key
+			SpecifyAttributeLayout,      // String shader key, String vertex array key
+			SetUniformInt,               // String shader key, String uniform key, int32
+			SetUniformFloat,             // String shader key, String uniform key, float
+			SetUniformVec3,              // String shader key, String uniform key, 3 x float
+			SetUniformVec4,              // String shader key, String uniform key, 4 x float
+			SetUniformMat4,              // String shader key, String uniform key, 16 x float
+			DispatchCompute,             // String key, uint32 groups x, y, z
+			InsertMemoryBarrier,         // uint32 barriers
+			SetUniformBufferData,        // String name, uint32 offset, Blob data
+			NumCommands
+		};
+
+		static_assert(sizeof(Header) == 8, "Trace header must be packed");
+	}
+
+} // namespace GLW
+
+#endif // _TRACE_FORMAT_H_
@@ -0,0 +1,77 @@
+// File: TracePlayer.h
+// Author: Rowan Clark
+//
+// Description:
+// Replays a trace recorded by GlWrap::StartTrace, one frame at a time, by
+// making the same GlWrap calls with the same arguments and data. Resources
+// are recreated from the data held in the trace so the replay does not need
+// any of the original image, mesh or shader files. A context must be
+// current before the player is created and stay current while it is used.
+//
+// ---- Usage ----
+//
+//    GLW::TracePlayer player("capture.glwt");
+//    while (player.ReplayFrame())
+//    {
+//        swapBuffers();
+//    }
+
+#ifndef _TRACE_PLAYER_H_
+#define _TRACE_PLAYER_H_
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "GlWrap.h"
+#include "MappedFile.h"
+#include "TraceFormat.h"
+
+namespace GLW
+{
+
+	class TracePlayer : public GlWrap
+	{
+	public:
+		TracePlayer(const std::string& _tracePath);
+		~TracePlayer();
+
+		TracePlayer(const TracePlayer&) = delete;
+		TracePlayer& operator=(const TracePlayer&) = delete;
+
+		// Replay every call up to the next frame marker. Returns false, having replayed
+		// nothing, once the end of the trace has been reached.
+		bool ReplayFrame();
+
+		uint64_t GetNumFramesReplayed() const { return numFrames; }
+		uint64_t GetNumCommandsReplayed() const { return numCommands; }
+
+	private:
+		MappedFileObj file;
+		const unsigned char* cursor;
+		const unsigned char* end;
+
+		std::vector<std::string> strings;
+
+		uint64_t numFrames;
+		uint64_t numCommands;
+
+		void ReplayCommand(TraceFormat::Command _command);
+
+		template <typename T>
+		T Read();
+		void ReadBytes(void* _data, size_t _size);
+		const std::string& ReadString();
+		std::string ReadText();
+		const unsigned char* ReadBlob(uint64_t& _size);
+		AttributeLayout ReadLayout();
+		glm::vec3 ReadVec3();
+		glm::vec4 ReadVec4();
+		glm::mat4 ReadMat4();
+
+		const unsigned char* Take(uint64_t _size);
+	};
+
+} // namespace GLW
+
+#endif // _TRACE_PLAYER_H_
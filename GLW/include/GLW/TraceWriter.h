@@ -0,0 +1,188 @@
+// File: TraceWriter.h
+// Author: Rowan Clark
+//
+// Description:
+// Streams a GLW trace (see TraceFormat.h) to disk from a background thread.
+// The rendering thread copies each record into a single producer, single
+// consumer ring buffer, which takes no locks and makes no system calls, and
+// the writer thread drains the ring to the file. If the writer falls behind
+// and the ring fills up the rendering thread waits for space rather than
+// dropping records, since a trace with gaps cannot be replayed; GetNumStalls
+// reports how often that happened so the ring can be sized to avoid it.
+//
+// Only one thread may write records. TraceRecord is the usual way to write
+// them: it does nothing when given a null writer, so call sites do not need
+// to check whether tracing is on.
+//
+// ---- Usage ----
+//
+//    GLW::TraceWriterObj writer = GLW::TraceWriter::Make("capture.glwt");
+//    GLW::TraceRecord(writer.get(), GLW::TraceFormat::Command::SetViewport).Value(0).Value(0).Value(width).Value(height);
+
+#ifndef _TRACE_WRITER_H_
+#define _TRACE_WRITER_H_
+
+#include <atomic>
+#include <cstdint>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/type_ptr.hpp>
+
+#include "AttributeLayout.h"
+#include "TraceFormat.h"
+
+namespace GLW
+{
+
+	class TraceWriter
+	{
+	public:
+		// _bufferSize is rounded up to a power of two
+		TraceWriter(const std::string& _path, size_t _bufferSize = 16 * 1024 * 1024);
+		// Writes out everything still buffered before closing the file
+		~TraceWriter();
+
+		TraceWriter(const TraceWriter&) = delete;
+		TraceWriter& operator=(const TraceWriter&) = delete;
+
+		using TraceWriterObj = std::unique_ptr<TraceWriter>;
+		static TraceWriterObj Make(const std::string& _path, size_t _bufferSize = 16 * 1024 * 1024)
+		{
+			return std::make_unique<TraceWriter>(_path, _bufferSize);
+		}
+
+		void WriteCommand(TraceFormat::Command _command);
+		template <typename T>
+		void WriteValue(const T& _value)
+		{
+			static_assert(std::is_arithmetic<T>::value, "Trace values must be integers or floats");
+			WriteBytes(&_value, sizeof(T));
+		}
+		void WriteString(const std::string& _string);
+		void WriteText(const std::string& _text);
+		void WriteBlob(const void* _data, uint64_t _size);
+		void WriteLayout(const AttributeLayout& _attributeLayout);
+
+		// Copy raw bytes into the ring, waiting for the writer thread if it is full
+		void WriteBytes(const void* _data, size_t _size);
+
+		// Block until the writer thread has written everything so far to the file
+		void Flush();
+
+		const std::string& GetPath() const { return path; }
+		uint64_t GetBytesWritten() const { return head.load(std::memory_order_relaxed); }
+		// Number of times a record had to wait for space in the ring
+		uint64_t GetNumStalls() const { return numStalls; }
+		// True if the file could not be written, records are discarded from then on
+		bool HasFailed() const { return failed.load(std::memory_order_relaxed); }
+
+	private:
+		std::string path;
+		std::ofstream file;
+
+		std::vector<unsigned char> ring;
+		size_t ringMask;
+
+		// Total bytes ever written by the producer and read by the consumer, on separate
+		// cache lines so the two threads do not contend for the same line
+		alignas(64) std::atomic<uint64_t> head;
+		alignas(64) std::atomic<uint64_t> tail;
+		alignas(64) uint64_t cachedTail;
+		// How much of the trace has been flushed to the file
+		std::atomic<uint64_t> flushed;
+
+		uint64_t numStalls;
+		std::unordered_map<std::string, uint32_t> stringIds;
+
+		std::atomic<bool> stopping;
+		std::atomic<bool> failed;
+		std::thread writer;
+
+		void Run();
+	};
+
+	using TraceWriterObj = TraceWriter::TraceWriterObj;
+
+	// Writes one record to a trace writer, or nothing if the writer is null
+	class TraceRecord
+	{
+	public:
+		TraceRecord(TraceWriter* _writer, TraceFormat::Command _command) :
+			writer(_writer)
+		{
+			if (writer)
+			{
+				writer->WriteCommand(_command);
+			}
+		}
+
+		template <typename T>
+		TraceRecord& Value(const T& _value)
+		{
+			if (writer)
+			{
+				writer->WriteValue(_value);
+			}
+			return *this;
+		}
+		TraceRecord& Value(const glm::vec3& _value) { return Floats(glm::value_ptr(_value), 3); }
+		TraceRecord& Value(const glm::vec4& _value) { return Floats(glm::value_ptr(_value), 4); }
+		TraceRecord& Value(const glm::mat4& _value) { return Floats(glm::value_ptr(_value), 16); }
+
+		TraceRecord& String(const std::string& _string)
+		{
+			if (writer)
+			{
+				writer->WriteString(_string);
+			}
+			return *this;
+		}
+		TraceRecord& Text(const std::string& _text)
+		{
+			if (writer)
+			{
+				writer->WriteText(_text);
+			}
+			return *this;
+		}
+		TraceRecord& Blob(const void* _data, uint64_t _size)
+		{
+			if (writer)
+			{
+				writer->WriteBlob(_data, _size);
+			}
+			return *this;
+		}
+		TraceRecord& Layout(const AttributeLayout& _attributeLayout)
+		{
+			if (writer)
+			{
+				writer->WriteLayout(_attributeLayout);
+			}
+			return *this;
+		}
+
+	private:
+		TraceWriter* writer;
+
+		TraceRecord& Floats(const float* _values, size_t _count)
+		{
+			if (writer)
+			{
+				writer->WriteBytes(_values, _count * sizeof(float));
+			}
+			return *this;
+		}
+	};
+
+} // namespace GLW
+
+#endif // _TRACE_WRITER_H_
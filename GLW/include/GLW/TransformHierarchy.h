@@ -0,0 +1,159 @@
+// File: TransformHierarchy.h
+// Author: Rowan Clark
+//
+// Description:
+// Parent relative transforms for large scenes. Each transform is a
+// translation, rotation quaternion and scale with an optional parent, held
+// as structure-of-arrays sorted by depth so that every parent comes before
+// its children and each depth level is one contiguous range. Update only
+// recomputes the world matrices of transforms which changed and of their
+// descendants, one level at a time, splitting large levels across worker
+// threads. Matrices are multiplied with AVX2 or SSE where the compiler
+// targets them.
+//
+// WriteMatrices writes view projection * world for every transform straight
+// into memory such as a mapped buffer, in handle order and _stride bytes
+// apart. With a stride of sizeof(glm::mat4) that is the layout of a mat4
+// array in a std140 uniform block or std430 storage block, which GlWrap's
+// SetUniformBuffer and SetStorageBuffer overloads for a TransformHierarchy use.
+//
+// Handles are assigned in the order transforms are added and stay valid;
+// transforms cannot be removed or reparented.
+//
+// ---- Usage ----
+//
+//    GLW::TransformHierarchyObj transforms = GLW::TransformHierarchy::Make();
+//    GLW::TransformHierarchy::Handle car = transforms->Add();
+//    GLW::TransformHierarchy::Handle wheel = transforms->Add(car, glm::vec3(1.0f, 0.0f, 2.0f));
+//
+//    // Each frame
+//    transforms->SetTranslation(car, carPosition);
+//    transforms->Update();
+//    transforms->WriteMatrices(mappedBuffer, sizeof(glm::mat4), projection * view);
+
+#ifndef _TRANSFORM_HIERARCHY_H_
+#define _TRANSFORM_HIERARCHY_H_
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+namespace GLW
+{
+
+	class TransformHierarchy
+	{
+	public:
+		using Handle = uint32_t;
+		static const Handle NoParent = 0xFFFFFFFF;
+
+		// _numThreads includes the calling thread, 0 uses one per hardware thread
+		TransformHierarchy(unsigned int _numThreads = 0);
+		~TransformHierarchy();
+
+		TransformHierarchy(const TransformHierarchy&) = delete;
+		TransformHierarchy& operator=(const TransformHierarchy&) = delete;
+
+		using TransformHierarchyObj = std::unique_ptr<TransformHierarchy>;
+		static TransformHierarchyObj Make(unsigned int _numThreads = 0)
+		{
+			return std::make_unique<TransformHierarchy>(_numThreads);
+		}
+
+		// The parent must already have been added
+		Handle Add(Handle _parent = NoParent,
+			const glm::vec3& _translation = glm::vec3(0.0f),
+			const glm::quat& _rotation = glm::quat(1.0f, 0.0f, 0.0f, 0.0f),
+			const glm::vec3& _scale = glm::vec3(1.0f));
+
+		void SetTranslation(Handle _handle, const glm::vec3& _translation);
+		void SetRotation(Handle _handle, const glm::quat& _rotation);
+		void SetScale(Handle _handle, const glm::vec3& _scale);
+		void SetLocal(Handle _handle, const glm::vec3& _translation, const glm::quat& _rotation, const glm::vec3& _scale);
+
+		const glm::vec3& GetTranslation(Handle _handle) const { return translations[GetSlot(_handle)]; }
+		const glm::quat& GetRotation(Handle _handle) const { return rotations[GetSlot(_handle)]; }
+		const glm::vec3& GetScale(Handle _handle) const { return scales[GetSlot(_handle)]; }
+		Handle GetParent(Handle _handle) const;
+		// Only reflects changes made before the last Update
+		const glm::mat4& GetWorldMatrix(Handle _handle) const { return worldMatrices[GetSlot(_handle)]; }
+
+		size_t GetSize() const { return slots.size(); }
+		// Number of world matrices the last Update recomputed
+		size_t GetNumUpdated() const { return numUpdated; }
+
+		// Recompute the world matrices of changed transforms and their descendants
+		void Update();
+
+		// Write _viewProjection * world for every transform in handle order, _stride bytes apart.
+		// _destination needs room for GetSize() matrices and may be write combined mapped memory.
+		void WriteMatrices(void* _destination, size_t _stride, const glm::mat4& _viewProjection);
+		// Write the world matrices alone, e.g. for instanced draws which apply the camera in the shader
+		void WriteWorldMatrices(void* _destination, size_t _stride);
+
+	private:
+		// Per transform data in depth order, indexed by slot
+		std::vector<glm::vec3> translations;
+		std::vector<glm::quat> rotations;
+		std::vector<glm::vec3> scales;
+		std::vector<uint32_t> parents;      // parent slot or NoParent
+		std::vector<uint32_t> depths;
+		std::vector<uint8_t> dirty;         // local transform changed, or recomputed during Update
+		std::vector<glm::mat4> worldMatrices;
+		std::vector<Handle> handles;        // handle of each slot
+
+		// Slot of each handle
+		std::vector<uint32_t> slots;
+		// First slot of each depth level, plus one past the end
+		std::vector<uint32_t> levelStarts;
+		// Transforms were added out of depth order since the last sort
+		bool unsorted;
+		// A transform has changed since the last Update
+		bool anyDirty;
+		size_t numUpdated;
+
+		uint32_t GetSlot(Handle _handle) const;
+		void MarkDirty(uint32_t _slot);
+		// Restore depth order with a counting sort and rebuild the level ranges
+		void Sort();
+		// Recompute the dirty transforms in [_begin, _end) of one level, returns how many
+		size_t UpdateRange(uint32_t _begin, uint32_t _end);
+		void WriteRange(unsigned char* _destination, size_t _stride, const glm::mat4* _viewProjection, size_t _begin, size_t _end) const;
+
+		/*********************************
+		*********** Worker pool **********
+		*********************************/
+		// Split [0, _count) into chunks of _grain and run _job on them across the workers and
+		// the calling thread. Small counts run on the calling thread alone.
+		void ParallelFor(size_t _count, size_t _grain, const std::function<void(size_t, size_t)>& _job);
+		void RunChunks();
+		void RunWorker();
+
+		std::vector<std::thread> workers;
+		std::mutex mutex;
+		std::condition_variable jobAdded;
+		std::condition_variable jobFinished;
+		const std::function<void(size_t, size_t)>* job;
+		size_t jobCount;
+		size_t jobGrain;
+		size_t numChunks;
+		std::atomic<size_t> nextChunk;
+		unsigned long long jobGeneration;
+		unsigned int numBusyWorkers;
+		bool stopping;
+	};
+
+	using TransformHierarchyObj = TransformHierarchy::TransformHierarchyObj;
+
+} // namespace GLW
+
+#endif // _TRANSFORM_HIERARCHY_H_
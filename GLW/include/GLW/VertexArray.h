@@ -6,9 +6,20 @@
 // which stores the format of the vertex data and the Vertex Buffer
 // Objects which contain the actualy vertex data. This class contains
 // one vertex buffer and one element buffer.
+//
+// With GL 4.5 direct state access the buffers are created with immutable
+// storage and the vertex array is set up without binding anything, older
+// contexts fall back to binding each object to edit it.
+//
+// A vertex array can instead be given a shared VertexFormat, in which case
+// Bind only swaps the buffers the format reads from. The vertex array's own
+// vertex array object is only created the first time it is bound or given an
+// attribute layout, so one drawn through a format never makes one. Binding
+// the vertex array's own vertex array object does not tell the format cache,
+// call VertexFormatCache::ForgetBinding afterwards when mixing the two.
 
 #ifndef _VERTEX_ARRAY_H_
-#define _VERTEX_ARRAY_H
+#define _VERTEX_ARRAY_H_
 
 #include <memory>
 #include <vector>
@@ -16,7 +27,11 @@
 #include <glad/glad.h>
 
 #include "AttributeLayout.h"
+#include "BufferHeap.h"
+#include "Capabilities.h"
 #include "CheckOpenGLError.h"
+#include "ShaderProgram.h"
+#include "VertexFormat.h"
 
 namespace GLW
 {
@@ -28,6 +43,17 @@ namespace GLW
 		VertexArray(const std::vector<float>& _vertices,
 			const std::vector<unsigned int>& _indices,
 			const AttributeLayout& _attributeLayout);
+		// Upload from memory owned by the caller (e.g. a memory mapped file) without copying it first.
+		// _numVertexValues is the number of floats, not the number of vertices.
+		VertexArray(const float* _vertices, size_t _numVertexValues,
+			const unsigned int* _indices, size_t _numIndices,
+			const AttributeLayout& _attributeLayout);
+		// Sub-allocate the vertex and element data from heaps rather than creating buffers.
+		// The heaps must outlive the vertex array and may be the same heap.
+		VertexArray(BufferHeap& _vertexHeap, BufferHeap& _indexHeap,
+			const float* _vertices, size_t _numVertexValues,
+			const unsigned int* _indices, size_t _numIndices,
+			const AttributeLayout& _attributeLayout);
 		~VertexArray();
 
 		// 
@@ -36,6 +62,21 @@ namespace GLW
 		{
 			return std::make_unique<VertexArray>(_vertices, _indices, _attributeLayout);
 		}
+		static VertexArrayObj Make(const float* _vertices, size_t _numVertexValues,
+			const unsigned int* _indices, size_t _numIndices, const AttributeLayout& _attributeLayout)
+		{
+			return std::make_unique<VertexArray>(_vertices, _numVertexValues, _indices, _numIndices, _attributeLayout);
+		}
+		static VertexArrayObj Make(BufferHeap& _heap, const std::vector<float>& _vertices,
+			const std::vector<unsigned int>& _indices, const AttributeLayout& _attributeLayout)
+		{
+			return std::make_unique<VertexArray>(_heap, _heap, _vertices.data(), _vertices.size(), _indices.data(), _indices.size(), _attributeLayout);
+		}
+		static VertexArrayObj Make(BufferHeap& _heap, const float* _vertices, size_t _numVertexValues,
+			const unsigned int* _indices, size_t _numIndices, const AttributeLayout& _attributeLayout)
+		{
+			return std::make_unique<VertexArray>(_heap, _heap, _vertices, _numVertexValues, _indices, _numIndices, _attributeLayout);
+		}
 
 		// A vertex array must be bound before it can be rendered.
 		void Bind();
@@ -43,15 +84,47 @@ namespace GLW
 		// Render the vertex array as triangles
 		void Render();
 
+		// Point the shader's attributes at this vertex array's data, matched by name
+		void SpecifyAttributeLayout(const ShaderProgram& _shaderProgram);
+		// Bind through a shared format instead of this vertex array's own state, nullptr to go back.
+		// The format must have the same stride and outlive the vertex array.
+		void SetVertexFormat(VertexFormat* _vertexFormat);
+		VertexFormat* GetVertexFormat() const { return vertexFormat; }
+
 		// Used to bind the vertex layout to the attributes in the shader
 		AttributeLayout GetAttributeLayout();
 
+		// Draw parameters, for building indirect draw commands. The first index and
+		// base vertex are only meaningful for heap allocated vertex arrays and can
+		// change when the heap is defragmented.
+		bool IsHeapAllocated() const { return vertexHeap != nullptr; }
+		const BufferHeap* GetVertexHeap() const { return vertexHeap; }
+		int GetNumIndices() const { return numIndices; }
+		GLuint GetFirstIndex() const;
+		GLint GetBaseVertex() const;
+
+		GLuint GetVertexBuffer() const;
+		GLuint GetElementBuffer() const;
+
 	private:
 		GLuint vao, vbo, ebo;
 
 		int numIndices;
 
+		// Only set when the data lives in heaps
+		BufferHeap* vertexHeap;
+		BufferHeap* indexHeap;
+		BufferHeap::Handle vertexAllocation, indexAllocation;
+		GLsizei vertexStride;
+
+		VertexFormat* vertexFormat;
+
 		AttributeLayout attributeLayout;
+
+		void BindOwnVertexArray();
+		void CreateOwnVertexArray();
+
+		static GLsizei CalculateStride(const AttributeLayout& _attributeLayout);
 	};
 
 	using VertexArrayObj = VertexArray::VertexArrayObj;
@@ -0,0 +1,133 @@
+// File: VertexFormat.h
+// Author: Rowan Clark
+//
+// Description:
+// A vertex array object which only describes the layout of a vertex, using
+// separate attribute formats and buffer bindings (GL 4.3). Any number of
+// meshes with the same layout can share one VertexFormat, switching between
+// them only rebinds the vertex and element buffers rather than the whole
+// vertex array, and nothing is rebound when consecutive meshes share
+// buffers (e.g. meshes sub-allocated from one BufferHeap).
+//
+// VertexFormatCache builds each distinct format once. Formats are keyed by
+// the resolved attribute locations, offsets and stride rather than the
+// attribute names, so shaders which agree on locations share a format.
+// The cache also remembers which of its formats is bound, which is state of
+// the context, so each context needs its own cache.
+//
+// ---- Usage ----
+//
+//    GLW::VertexFormatCache formats;
+//    mesh->SetVertexFormat(&formats.Get(mesh->GetAttributeLayout(), *shader));
+//    mesh->Bind();
+//    mesh->Render();
+//
+//    // After binding any other vertex array, e.g. drawing a SpriteBatch
+//    formats.ForgetBinding();
+
+#ifndef _VERTEX_FORMAT_H_
+#define _VERTEX_FORMAT_H_
+
+#include <map>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include <glad/glad.h>
+
+#include "AttributeLayout.h"
+#include "Capabilities.h"
+#include "CheckOpenGLError.h"
+#include "ShaderProgram.h"
+
+namespace GLW
+{
+
+	class VertexFormatCache;
+
+	class VertexFormat
+	{
+	public:
+		struct Attribute
+		{
+			GLuint location;
+			GLint numValues;
+			GLuint offset;
+
+			bool operator<(const Attribute& _other) const;
+		};
+
+		// The binding point every attribute reads from
+		static const GLuint BindingIndex = 0;
+
+		// Formats are created by a cache, which tracks the one bound in its context
+		VertexFormat(VertexFormatCache& _cache, const std::vector<Attribute>& _attributes, GLsizei _stride);
+		~VertexFormat();
+
+		VertexFormat(const VertexFormat&) = delete;
+		VertexFormat& operator=(const VertexFormat&) = delete;
+
+		using VertexFormatObj = std::unique_ptr<VertexFormat>;
+		static VertexFormatObj Make(VertexFormatCache& _cache, const std::vector<Attribute>& _attributes, GLsizei _stride)
+		{
+			return std::make_unique<VertexFormat>(_cache, _attributes, _stride);
+		}
+
+		// Bind the format's vertex array, this is skipped if it is already bound
+		void Bind();
+		// Source vertices and indices from these buffers, the format must be bound.
+		// Buffers which are already bound are not bound again.
+		void BindBuffers(GLuint _vertexBuffer, GLuint _elementBuffer);
+
+		GLsizei GetStride() const { return stride; }
+
+		// Call when buffers bound through this format are deleted so the next BindBuffers rebinds
+		void ForgetBuffers();
+
+		// True when the context supports separate attribute formats
+		static bool IsSupported();
+
+		// Match each attribute in a layout to its location in a shader. Attributes the
+		// shader does not use are left out but still take up space in the vertex.
+		static std::vector<Attribute> Resolve(const AttributeLayout& _attributeLayout,
+			const ShaderProgram& _shaderProgram, GLsizei& _stride);
+
+	private:
+		VertexFormatCache& cache;
+
+		GLuint vao;
+		GLsizei stride;
+
+		GLuint vertexBuffer;
+		GLuint elementBuffer;
+	};
+
+	using VertexFormatObj = VertexFormat::VertexFormatObj;
+
+	class VertexFormatCache
+	{
+	public:
+		VertexFormatCache();
+		~VertexFormatCache();
+
+		// The format for a layout as seen by a shader, created the first time it is requested
+		VertexFormat& Get(const AttributeLayout& _attributeLayout, const ShaderProgram& _shaderProgram);
+
+		size_t GetNumFormats() const { return formats.size(); }
+
+		// Call after binding a vertex array outside of this cache so the next Bind is not skipped
+		void ForgetBinding();
+
+	private:
+		friend class VertexFormat;
+
+		// The format whose vertex array is bound in this cache's context, if any
+		VertexFormat* boundFormat;
+
+		using Key = std::pair<GLsizei, std::vector<VertexFormat::Attribute>>;
+		std::map<Key, VertexFormatObj> formats;
+	};
+
+} // namespace GLW
+
+#endif // _VERTEX_FORMAT_H_
@@ -0,0 +1,187 @@
+#include "GLW/BufferHeap.h"
+
+#include <algorithm>
+
+namespace GLW
+{
+
+	BufferHeap::BufferHeap(uint64_t _capacity) :
+		buffer(0), allocator(_capacity)
+	{
+		GL_CHECK(glGenBuffers(1, &buffer));
+		GL_CHECK(glBindBuffer(GL_COPY_WRITE_BUFFER, buffer));
+
+		// Immutable storage lets the driver skip revalidating the buffer on every use
+		if (Capabilities::BufferStorage())
+		{
+			GL_CHECK(glBufferStorage(GL_COPY_WRITE_BUFFER, _capacity, nullptr, GL_DYNAMIC_STORAGE_BIT));
+		}
+		else
+		{
+			GL_CHECK(glBufferData(GL_COPY_WRITE_BUFFER, _capacity, nullptr, GL_STATIC_DRAW));
+		}
+
+		GL_CHECK(glBindBuffer(GL_COPY_WRITE_BUFFER, 0));
+	}
+
+	BufferHeap::~BufferHeap()
+	{
+		glDeleteBuffers(1, &buffer);
+	}
+
+	BufferHeap::Handle BufferHeap::Allocate(uint64_t _size, uint64_t _alignment, const void* _data)
+	{
+		OffsetAllocator::Allocation allocation = allocator.Allocate(_size, _alignment);
+		if (allocation.node == OffsetAllocator::NoSpace)
+		{
+			Stats stats = GetStats();
+			std::cerr << "Buffer heap cannot fit " << _size << " bytes, " << stats.freeBytes
+				<< " bytes free in " << stats.numFreeBlocks << " blocks" << std::endl;
+			throw std::runtime_error("BufferHeap Error");
+		}
+
+		Handle handle;
+		if (!freeHandles.empty())
+		{
+			handle = freeHandles.back();
+			freeHandles.pop_back();
+		}
+		else
+		{
+			handle = static_cast<Handle>(records.size());
+			records.emplace_back();
+		}
+		records[handle] = { allocation, _size, _alignment, true };
+
+		if (_data)
+		{
+			Upload(handle, 0, _size, _data);
+		}
+
+		return handle;
+	}
+
+	void BufferHeap::Free(Handle _handle)
+	{
+		if (_handle >= records.size() || !records[_handle].live)
+		{
+			return;
+		}
+
+		allocator.Free(records[_handle].allocation);
+		records[_handle].live = false;
+		freeHandles.push_back(_handle);
+	}
+
+	void BufferHeap::Upload(Handle _handle, uint64_t _offset, uint64_t _size, const void* _data)
+	{
+		const Record& record = GetRecord(_handle);
+		if (_offset + _size > record.size)
+		{
+			std::cerr << "Upload of " << _size << " bytes at " << _offset << " overruns an allocation of "
+				<< record.size << " bytes" << std::endl;
+			throw std::runtime_error("BufferHeap Error");
+		}
+
+		GL_CHECK(glBindBuffer(GL_COPY_WRITE_BUFFER, buffer));
+		GL_CHECK(glBufferSubData(GL_COPY_WRITE_BUFFER, record.allocation.offset + _offset, _size, _data));
+		GL_CHECK(glBindBuffer(GL_COPY_WRITE_BUFFER, 0));
+	}
+
+	uint64_t BufferHeap::GetOffset(Handle _handle) const
+	{
+		return GetRecord(_handle).allocation.offset;
+	}
+
+	uint64_t BufferHeap::GetSize(Handle _handle) const
+	{
+		return GetRecord(_handle).size;
+	}
+
+	void BufferHeap::Defragment()
+	{
+		std::vector<Handle> live;
+		uint64_t largest = 0;
+		for (Handle handle = 0; handle < records.size(); ++handle)
+		{
+			if (records[handle].live)
+			{
+				live.push_back(handle);
+				largest = std::max(largest, records[handle].size);
+			}
+		}
+
+		if (live.empty())
+		{
+			allocator.Reset();
+			return;
+		}
+
+		std::sort(live.begin(), live.end(), [this](Handle _a, Handle _b)
+		{
+			return records[_a].allocation.offset < records[_b].allocation.offset;
+		});
+
+		// Allocating in address order from an empty allocator packs the blocks together, and
+		// each one can only move down, so no allocation overwrites one which has not moved yet
+		OffsetAllocator packed(allocator.GetCapacity());
+
+		// Source and destination ranges within one buffer must not overlap, so go through a scratch buffer
+		GLuint scratch = 0;
+		GL_CHECK(glGenBuffers(1, &scratch));
+		GL_CHECK(glBindBuffer(GL_COPY_WRITE_BUFFER, scratch));
+		GL_CHECK(glBufferData(GL_COPY_WRITE_BUFFER, largest, nullptr, GL_STREAM_COPY));
+		GL_CHECK(glBindBuffer(GL_COPY_WRITE_BUFFER, 0));
+
+		for (auto handle : live)
+		{
+			Record& record = records[handle];
+			OffsetAllocator::Allocation moved = packed.Allocate(record.size, record.alignment);
+
+			if (moved.offset != record.allocation.offset)
+			{
+				GL_CHECK(glBindBuffer(GL_COPY_READ_BUFFER, buffer));
+				GL_CHECK(glBindBuffer(GL_COPY_WRITE_BUFFER, scratch));
+				GL_CHECK(glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, record.allocation.offset, 0, record.size));
+				GL_CHECK(glBindBuffer(GL_COPY_READ_BUFFER, scratch));
+				GL_CHECK(glBindBuffer(GL_COPY_WRITE_BUFFER, buffer));
+				GL_CHECK(glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, moved.offset, record.size));
+			}
+
+			record.allocation = moved;
+		}
+
+		GL_CHECK(glBindBuffer(GL_COPY_READ_BUFFER, 0));
+		GL_CHECK(glBindBuffer(GL_COPY_WRITE_BUFFER, 0));
+		glDeleteBuffers(1, &scratch);
+
+		allocator = std::move(packed);
+	}
+
+	BufferHeap::Stats BufferHeap::GetStats() const
+	{
+		OffsetAllocator::Stats allocatorStats = allocator.GetStats();
+
+		Stats stats;
+		stats.capacity = allocatorStats.capacity;
+		stats.usedBytes = allocatorStats.usedBytes;
+		stats.freeBytes = allocatorStats.freeBytes;
+		stats.largestFreeBlock = allocatorStats.largestFreeBlock;
+		stats.numAllocations = allocatorStats.numAllocations;
+		stats.numFreeBlocks = allocatorStats.numFreeBlocks;
+		stats.fragmentation = (stats.freeBytes == 0) ? 0.0f
+			: 1.0f - static_cast<float>(stats.largestFreeBlock) / static_cast<float>(stats.freeBytes);
+		return stats;
+	}
+
+	const BufferHeap::Record& BufferHeap::GetRecord(Handle _handle) const
+	{
+		if (_handle >= records.size() || !records[_handle].live)
+		{
+			std::cerr << "Buffer heap handle " << _handle << " is not allocated" << std::endl;
+			throw std::runtime_error("BufferHeap Error");
+		}
+		return records[_handle];
+	}
+
+} // namespace GLW
@@ -0,0 +1,75 @@
+#include "GLW/ComputeProgram.h"
+
+namespace GLW
+{
+
+	ComputeProgram::ComputeProgram(const std::string& _source) :
+		computeShader(0), localSize{ 1, 1, 1 }
+	{
+		if (!IsSupported())
+		{
+			std::cerr << "Compute shaders need an OpenGL 4.3 context" << std::endl;
+			throw std::runtime_error("Shader error");
+		}
+
+		GL_CHECK(shaderProgram = glCreateProgram());
+
+		CompileShader(computeShader, GL_COMPUTE_SHADER, _source);
+
+		GL_CHECK(glAttachShader(shaderProgram, computeShader));
+		GL_CHECK(glLinkProgram(shaderProgram));
+
+		GLint isLinked = 0;
+		glGetProgramiv(shaderProgram, GL_LINK_STATUS, &isLinked);
+		if (isLinked == GL_FALSE)
+		{
+			GLint maxLength = 0;
+			glGetProgramiv(shaderProgram, GL_INFO_LOG_LENGTH, &maxLength);
+
+			std::vector<GLchar> errorLog(maxLength + 1);
+			glGetProgramInfoLog(shaderProgram, maxLength, &maxLength, &errorLog[0]);
+			std::cerr << &errorLog[0];
+
+			// The program is deleted by ~ShaderProgram but the compute shader belongs to this class
+			glDeleteShader(computeShader);
+			computeShader = 0;
+
+			throw std::runtime_error("Error linking compute shader");
+		}
+
+		GL_CHECK(glGetProgramiv(shaderProgram, GL_COMPUTE_WORK_GROUP_SIZE, localSize));
+	}
+
+	ComputeProgram::~ComputeProgram()
+	{
+		glDeleteShader(computeShader);
+	}
+
+	void ComputeProgram::Dispatch(GLuint _numGroupsX, GLuint _numGroupsY, GLuint _numGroupsZ)
+	{
+		Use();
+		GL_CHECK(glDispatchCompute(_numGroupsX, _numGroupsY, _numGroupsZ));
+	}
+
+	void ComputeProgram::DispatchIndirect(GLintptr _offset)
+	{
+		Use();
+		GL_CHECK(glDispatchComputeIndirect(_offset));
+	}
+
+	GLuint ComputeProgram::GetNumGroups(GLuint _numItems) const
+	{
+		return (_numItems + localSize[0] - 1) / localSize[0];
+	}
+
+	void ComputeProgram::Barrier(GLbitfield _barriers)
+	{
+		GL_CHECK(glMemoryBarrier(_barriers));
+	}
+
+	bool ComputeProgram::IsSupported()
+	{
+		return GLAD_GL_VERSION_4_3 || (GLAD_GL_ARB_compute_shader && GLAD_GL_ARB_shader_storage_buffer_object);
+	}
+
+} // namespace GLW
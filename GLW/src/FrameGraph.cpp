@@ -0,0 +1,512 @@
+#include "GLW/FrameGraph.h"
+
+#include <algorithm>
+#include <functional>
+#include <queue>
+
+namespace GLW
+{
+
+	FrameGraph::FrameGraph() :
+		compiled(false)
+	{
+
+	}
+
+	FrameGraph::~FrameGraph()
+	{
+
+	}
+
+	FrameGraph::ResourceHandle FrameGraph::CreateTarget(const std::string& _name, GLenum _internalFormat, int _width, int _height)
+	{
+		resources.push_back({ _name, { _internalFormat, _width, _height }, false, false, 0, -1, -1, nullptr });
+		compiled = false;
+		return static_cast<ResourceHandle>(resources.size() - 1);
+	}
+
+	FrameGraph::ResourceHandle FrameGraph::ImportBackbuffer(const std::string& _name, int _width, int _height)
+	{
+		resources.push_back({ _name, { GL_NONE, _width, _height }, true, true, 0, -1, -1, nullptr });
+		compiled = false;
+		return static_cast<ResourceHandle>(resources.size() - 1);
+	}
+
+	void FrameGraph::MarkOutput(ResourceHandle _resource)
+	{
+		CheckHandle(_resource);
+		resources[_resource].output = true;
+		compiled = false;
+	}
+
+	void FrameGraph::AddPass(const std::string& _name,
+		const std::vector<ResourceHandle>& _reads,
+		const std::vector<ResourceHandle>& _writes,
+		PassCallback _execute)
+	{
+		bool writesBackbuffer = false;
+		bool writesTarget = false;
+		for (auto resource : _reads)
+		{
+			CheckHandle(resource);
+			if (resources[resource].imported)
+			{
+				std::cerr << "Pass '" << _name << "' cannot sample from the backbuffer" << std::endl;
+				throw std::runtime_error("FrameGraph Error");
+			}
+		}
+		for (auto resource : _writes)
+		{
+			CheckHandle(resource);
+			(resources[resource].imported ? writesBackbuffer : writesTarget) = true;
+		}
+
+		if (writesBackbuffer && writesTarget)
+		{
+			std::cerr << "Pass '" << _name << "' writes to both the backbuffer and a render target" << std::endl;
+			throw std::runtime_error("FrameGraph Error");
+		}
+
+		passes.push_back({ _name, _reads, _writes, std::move(_execute), 0, false });
+		compiled = false;
+	}
+
+	void FrameGraph::Compile()
+	{
+		CullPasses();
+		SortPasses();
+		ComputeLifetimes();
+		compiled = true;
+	}
+
+	void FrameGraph::Execute()
+	{
+		if (!compiled)
+		{
+			std::cerr << "Frame graph must be compiled before it is executed" << std::endl;
+			throw std::runtime_error("FrameGraph Error");
+		}
+
+		// Outputs kept from an earlier Execute of the same graph
+		ReleaseTargets();
+
+		GLint viewport[4];
+		GL_CHECK(glGetIntegerv(GL_VIEWPORT, viewport));
+
+		for (int orderIndex = 0; orderIndex < static_cast<int>(executionOrder.size()); ++orderIndex)
+		{
+			Pass& pass = passes[executionOrder[orderIndex]];
+
+			// Allocate targets first used by this pass, these may alias targets released by earlier passes
+			for (auto& resource : resources)
+			{
+				if (!resource.imported && resource.firstUse == orderIndex)
+				{
+					resource.target = pool.Acquire(resource.desc);
+				}
+			}
+
+			Framebuffer* framebuffer = nullptr;
+			if (!pass.writes.empty())
+			{
+				framebuffer = BindPassFramebuffer(pass);
+			}
+
+			// A target's previous contents are undefined on its first write so the driver need not load them
+			if (framebuffer)
+			{
+				framebuffer->Invalidate(GetAttachments(pass, orderIndex, true));
+			}
+
+			pass.execute(*this);
+
+			// Nothing reads these attachments again so the driver need not store them
+			if (framebuffer)
+			{
+				framebuffer->Invalidate(GetAttachments(pass, orderIndex, false));
+			}
+
+			// Return targets whose last use was this pass so later passes can reuse them
+			for (auto& resource : resources)
+			{
+				if (!resource.imported && !resource.output && resource.lastUse == orderIndex)
+				{
+					pool.Release(resource.target);
+					resource.target = nullptr;
+				}
+			}
+		}
+
+		// Outputs stay acquired so they can be read after the frame, Reset returns them
+		for (auto& resource : resources)
+		{
+			if (resource.target && !resource.output)
+			{
+				pool.Release(resource.target);
+				resource.target = nullptr;
+			}
+		}
+
+		Framebuffer::BindDefault();
+		GL_CHECK(glViewport(viewport[0], viewport[1], viewport[2], viewport[3]));
+
+		std::vector<GLuint> evicted;
+		pool.EndFrame(&evicted);
+		EvictFramebuffers(evicted);
+	}
+
+	void FrameGraph::Reset()
+	{
+		ReleaseTargets();
+		resources.clear();
+		passes.clear();
+		executionOrder.clear();
+		compiled = false;
+	}
+
+	void FrameGraph::Trim()
+	{
+		std::vector<GLuint> evicted;
+		pool.Trim(&evicted);
+		EvictFramebuffers(evicted);
+	}
+
+	GLuint FrameGraph::GetTexture(ResourceHandle _resource)
+	{
+		CheckHandle(_resource);
+		if (!resources[_resource].target)
+		{
+			std::cerr << "Frame graph resource '" << resources[_resource].name << "' is not alive" << std::endl;
+			throw std::runtime_error("FrameGraph Error");
+		}
+		return resources[_resource].target->GetTexture();
+	}
+
+	void FrameGraph::BindTexture(ResourceHandle _resource)
+	{
+		GL_CHECK(glBindTexture(GL_TEXTURE_2D, GetTexture(_resource)));
+	}
+
+	std::vector<std::string> FrameGraph::GetExecutionOrder() const
+	{
+		std::vector<std::string> names;
+		for (auto passIndex : executionOrder)
+		{
+			names.push_back(passes[passIndex].name);
+		}
+		return names;
+	}
+
+	void FrameGraph::CheckHandle(ResourceHandle _resource) const
+	{
+		if (_resource < 0 || _resource >= static_cast<ResourceHandle>(resources.size()))
+		{
+			std::cerr << "Frame graph resource handle " << _resource << " is invalid" << std::endl;
+			throw std::runtime_error("FrameGraph Error");
+		}
+	}
+
+	void FrameGraph::ReleaseTargets()
+	{
+		for (auto& resource : resources)
+		{
+			if (resource.target)
+			{
+				pool.Release(resource.target);
+				resource.target = nullptr;
+			}
+		}
+	}
+
+	void FrameGraph::CullPasses()
+	{
+		for (auto& resource : resources)
+		{
+			resource.refCount = 0;
+		}
+
+		for (auto& pass : passes)
+		{
+			pass.refCount = static_cast<int>(pass.writes.size());
+			pass.culled = false;
+			for (auto resource : pass.reads)
+			{
+				++resources[resource].refCount;
+			}
+		}
+
+		// Start from every resource nobody reads and walk back up the graph
+		std::vector<ResourceHandle> unreferenced;
+		for (int resource = 0; resource < static_cast<int>(resources.size()); ++resource)
+		{
+			if (resources[resource].refCount == 0 && !resources[resource].output)
+			{
+				unreferenced.push_back(resource);
+			}
+		}
+
+		while (!unreferenced.empty())
+		{
+			ResourceHandle resource = unreferenced.back();
+			unreferenced.pop_back();
+
+			for (auto& pass : passes)
+			{
+				if (pass.refCount == 0 || std::find(pass.writes.begin(), pass.writes.end(), resource) == pass.writes.end())
+				{
+					continue;
+				}
+
+				if (--pass.refCount == 0)
+				{
+					for (auto read : pass.reads)
+					{
+						if (--resources[read].refCount == 0 && !resources[read].output)
+						{
+							unreferenced.push_back(read);
+						}
+					}
+				}
+			}
+		}
+
+		for (auto& pass : passes)
+		{
+			// Passes which write nothing have no observable effect
+			pass.culled = (pass.refCount == 0);
+		}
+	}
+
+	void FrameGraph::SortPasses()
+	{
+		const int numPasses = static_cast<int>(passes.size());
+		std::vector<std::vector<int>> dependents(numPasses);
+		std::vector<int> numDependencies(numPasses, 0);
+
+		auto addEdge = [&](int _from, int _to)
+		{
+			if (_from != _to && std::find(dependents[_from].begin(), dependents[_from].end(), _to) == dependents[_from].end())
+			{
+				dependents[_from].push_back(_to);
+				++numDependencies[_to];
+			}
+		};
+
+		auto touches = [](const std::vector<ResourceHandle>& _list, ResourceHandle _resource)
+		{
+			return std::find(_list.begin(), _list.end(), _resource) != _list.end();
+		};
+
+		// Passes writing the same target run in the order they were added. A read depends on
+		// the closest earlier writer, or on every writer if the target is written later.
+		for (int resource = 0; resource < static_cast<int>(resources.size()); ++resource)
+		{
+			int lastWriter = -1;
+			std::vector<int> writers;
+			std::vector<int> unorderedReaders;
+			std::vector<int> readersSinceWrite;
+
+			for (int pass = 0; pass < numPasses; ++pass)
+			{
+				if (passes[pass].culled)
+				{
+					continue;
+				}
+
+				if (touches(passes[pass].reads, resource))
+				{
+					if (lastWriter == -1)
+					{
+						unorderedReaders.push_back(pass);
+					}
+					else
+					{
+						addEdge(lastWriter, pass);
+						readersSinceWrite.push_back(pass);
+					}
+				}
+
+				if (touches(passes[pass].writes, resource))
+				{
+					if (lastWriter != -1)
+					{
+						addEdge(lastWriter, pass);
+					}
+					for (auto reader : readersSinceWrite)
+					{
+						addEdge(reader, pass);
+					}
+					readersSinceWrite.clear();
+					writers.push_back(pass);
+					lastWriter = pass;
+				}
+			}
+
+			for (auto reader : unorderedReaders)
+			{
+				for (auto writer : writers)
+				{
+					addEdge(writer, reader);
+				}
+			}
+		}
+
+		// Kahn's algorithm, breaking ties by the order passes were added
+		std::priority_queue<int, std::vector<int>, std::greater<int>> ready;
+		int numLive = 0;
+		for (int pass = 0; pass < numPasses; ++pass)
+		{
+			if (!passes[pass].culled)
+			{
+				++numLive;
+				if (numDependencies[pass] == 0)
+				{
+					ready.push(pass);
+				}
+			}
+		}
+
+		executionOrder.clear();
+		while (!ready.empty())
+		{
+			int pass = ready.top();
+			ready.pop();
+			executionOrder.push_back(pass);
+
+			for (auto dependent : dependents[pass])
+			{
+				if (--numDependencies[dependent] == 0)
+				{
+					ready.push(dependent);
+				}
+			}
+		}
+
+		if (static_cast<int>(executionOrder.size()) != numLive)
+		{
+			std::cerr << "Frame graph contains a dependency cycle" << std::endl;
+			throw std::runtime_error("FrameGraph Error");
+		}
+	}
+
+	void FrameGraph::ComputeLifetimes()
+	{
+		for (auto& resource : resources)
+		{
+			resource.firstUse = -1;
+			resource.lastUse = -1;
+		}
+
+		for (int orderIndex = 0; orderIndex < static_cast<int>(executionOrder.size()); ++orderIndex)
+		{
+			const Pass& pass = passes[executionOrder[orderIndex]];
+
+			for (auto resource : pass.reads)
+			{
+				if (resources[resource].firstUse == -1)
+				{
+					std::cerr << "Pass '" << pass.name << "' reads '" << resources[resource].name
+						<< "' before any pass has written it" << std::endl;
+					throw std::runtime_error("FrameGraph Error");
+				}
+				resources[resource].lastUse = orderIndex;
+			}
+
+			for (auto resource : pass.writes)
+			{
+				if (resources[resource].firstUse == -1)
+				{
+					resources[resource].firstUse = orderIndex;
+				}
+				resources[resource].lastUse = orderIndex;
+			}
+		}
+	}
+
+	Framebuffer* FrameGraph::BindPassFramebuffer(const Pass& _pass)
+	{
+		const Resource& first = resources[_pass.writes[0]];
+		if (first.imported)
+		{
+			Framebuffer::BindDefault();
+			GL_CHECK(glViewport(0, 0, first.desc.width, first.desc.height));
+			return nullptr;
+		}
+
+		std::vector<GLuint> key;
+		for (auto resource : _pass.writes)
+		{
+			key.push_back(resources[resource].target->GetTexture());
+		}
+
+		FramebufferObj& framebuffer = framebufferCache[key];
+		if (!framebuffer)
+		{
+			framebuffer = Framebuffer::Make();
+
+			unsigned int colorIndex = 0;
+			for (auto resource : _pass.writes)
+			{
+				RenderTarget* target = resources[resource].target;
+				GLenum attachment = RenderTarget::GetAttachmentPoint(target->GetInternalFormat(), colorIndex);
+				if (!RenderTarget::IsDepthFormat(target->GetInternalFormat()))
+				{
+					++colorIndex;
+				}
+				framebuffer->AttachTexture(attachment, target->GetTexture(), target->GetWidth(), target->GetHeight());
+			}
+
+			framebuffer->CheckComplete();
+		}
+
+		framebuffer->Bind();
+		GL_CHECK(glViewport(0, 0, framebuffer->GetWidth(), framebuffer->GetHeight()));
+		return framebuffer.get();
+	}
+
+	std::vector<GLenum> FrameGraph::GetAttachments(const Pass& _pass, int _orderIndex, bool _atStart)
+	{
+		std::vector<GLenum> attachments;
+
+		unsigned int colorIndex = 0;
+		for (auto resource : _pass.writes)
+		{
+			const Resource& written = resources[resource];
+			GLenum attachment = RenderTarget::GetAttachmentPoint(written.desc.internalFormat, colorIndex);
+			if (!RenderTarget::IsDepthFormat(written.desc.internalFormat))
+			{
+				++colorIndex;
+			}
+
+			bool discard = _atStart
+				? (written.firstUse == _orderIndex && std::find(_pass.reads.begin(), _pass.reads.end(), resource) == _pass.reads.end())
+				: (written.lastUse == _orderIndex && !written.output);
+
+			if (discard)
+			{
+				attachments.push_back(attachment);
+			}
+		}
+
+		return attachments;
+	}
+
+	void FrameGraph::EvictFramebuffers(const std::vector<GLuint>& _textures)
+	{
+		if (_textures.empty())
+		{
+			return;
+		}
+
+		for (auto cached = framebufferCache.begin(); cached != framebufferCache.end();)
+		{
+			bool stale = std::any_of(cached->first.begin(), cached->first.end(), [&](GLuint _texture)
+			{
+				return std::find(_textures.begin(), _textures.end(), _texture) != _textures.end();
+			});
+
+			cached = stale ? framebufferCache.erase(cached) : std::next(cached);
+		}
+	}
+
+} // namespace GLW
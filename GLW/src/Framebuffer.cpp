@@ -0,0 +1,240 @@
+#include "GLW/Framebuffer.h"
+
+namespace GLW
+{
+
+	namespace
+	{
+		// glTexImage2D needs a client format and type even when no data is uploaded,
+		// and they must be compatible with the internal format
+		void GetTransferFormat(GLenum _internalFormat, GLenum& _format, GLenum& _type)
+		{
+			switch (_internalFormat)
+			{
+			case GL_DEPTH_COMPONENT16:
+			case GL_DEPTH_COMPONENT24:
+			case GL_DEPTH_COMPONENT32:
+				_format = GL_DEPTH_COMPONENT; _type = GL_UNSIGNED_INT; break;
+			case GL_DEPTH_COMPONENT32F:
+				_format = GL_DEPTH_COMPONENT; _type = GL_FLOAT; break;
+			case GL_DEPTH24_STENCIL8:
+				_format = GL_DEPTH_STENCIL; _type = GL_UNSIGNED_INT_24_8; break;
+			case GL_DEPTH32F_STENCIL8:
+				_format = GL_DEPTH_STENCIL; _type = GL_FLOAT_32_UNSIGNED_INT_24_8_REV; break;
+			case GL_R8:
+				_format = GL_RED; _type = GL_UNSIGNED_BYTE; break;
+			case GL_R16F:
+			case GL_R32F:
+				_format = GL_RED; _type = GL_FLOAT; break;
+			case GL_RG8:
+				_format = GL_RG; _type = GL_UNSIGNED_BYTE; break;
+			case GL_RG16F:
+			case GL_RG32F:
+				_format = GL_RG; _type = GL_FLOAT; break;
+			case GL_RGB8:
+			case GL_SRGB8:
+				_format = GL_RGB; _type = GL_UNSIGNED_BYTE; break;
+			case GL_RGB16F:
+			case GL_RGB32F:
+			case GL_R11F_G11F_B10F:
+				_format = GL_RGB; _type = GL_FLOAT; break;
+			case GL_RGBA16F:
+			case GL_RGBA32F:
+				_format = GL_RGBA; _type = GL_FLOAT; break;
+			default:
+				_format = GL_RGBA; _type = GL_UNSIGNED_BYTE; break;
+			}
+		}
+	}
+
+	/*********************************
+	********** RenderTarget **********
+	*********************************/
+
+	RenderTarget::RenderTarget(GLenum _internalFormat, int _width, int _height) :
+		texture(0), internalFormat(_internalFormat), width(_width), height(_height)
+	{
+		if (_width <= 0 || _height <= 0)
+		{
+			std::cerr << "Render target size " << _width << "x" << _height << " is invalid" << std::endl;
+			throw std::runtime_error("RenderTarget Error");
+		}
+
+		GLenum format, type;
+		GetTransferFormat(_internalFormat, format, type);
+
+		GL_CHECK(glGenTextures(1, &texture));
+		GL_CHECK(glBindTexture(GL_TEXTURE_2D, texture));
+		GL_CHECK(glTexImage2D(GL_TEXTURE_2D, 0, _internalFormat, _width, _height, 0, format, type, nullptr));
+
+		// Render targets have a single level so must not use mipmap filtering
+		GL_CHECK(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, 0));
+		GL_CHECK(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE));
+		GL_CHECK(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE));
+		GL_CHECK(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR));
+		GL_CHECK(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR));
+		GL_CHECK(glBindTexture(GL_TEXTURE_2D, 0));
+	}
+
+	RenderTarget::~RenderTarget()
+	{
+		glDeleteTextures(1, &texture);
+	}
+
+	void RenderTarget::Bind()
+	{
+		GL_CHECK(glBindTexture(GL_TEXTURE_2D, texture));
+	}
+
+	bool RenderTarget::IsDepthFormat(GLenum _internalFormat)
+	{
+		switch (_internalFormat)
+		{
+		case GL_DEPTH_COMPONENT16:
+		case GL_DEPTH_COMPONENT24:
+		case GL_DEPTH_COMPONENT32:
+		case GL_DEPTH_COMPONENT32F:
+		case GL_DEPTH24_STENCIL8:
+		case GL_DEPTH32F_STENCIL8:
+			return true;
+		default:
+			return false;
+		}
+	}
+
+	GLenum RenderTarget::GetAttachmentPoint(GLenum _internalFormat, unsigned int _colorIndex)
+	{
+		if (_internalFormat == GL_DEPTH24_STENCIL8 || _internalFormat == GL_DEPTH32F_STENCIL8)
+		{
+			return GL_DEPTH_STENCIL_ATTACHMENT;
+		}
+		if (IsDepthFormat(_internalFormat))
+		{
+			return GL_DEPTH_ATTACHMENT;
+		}
+		return GL_COLOR_ATTACHMENT0 + _colorIndex;
+	}
+
+	/*********************************
+	********** Framebuffer ***********
+	*********************************/
+
+	Framebuffer::Framebuffer() :
+		fbo(0), width(0), height(0)
+	{
+		GL_CHECK(glGenFramebuffers(1, &fbo));
+	}
+
+	Framebuffer::~Framebuffer()
+	{
+		if (!renderbuffers.empty())
+		{
+			glDeleteRenderbuffers(static_cast<GLsizei>(renderbuffers.size()), renderbuffers.data());
+		}
+		glDeleteFramebuffers(1, &fbo);
+	}
+
+	void Framebuffer::AttachTexture(GLenum _attachment, GLuint _texture, int _width, int _height)
+	{
+		GL_CHECK(glBindFramebuffer(GL_FRAMEBUFFER, fbo));
+		GL_CHECK(glFramebufferTexture2D(GL_FRAMEBUFFER, _attachment, GL_TEXTURE_2D, _texture, 0));
+		GL_CHECK(glBindFramebuffer(GL_FRAMEBUFFER, 0));
+
+		textures.push_back(std::make_pair(_attachment, _texture));
+		TrackAttachment(_attachment, _width, _height);
+	}
+
+	void Framebuffer::AttachTarget(GLenum _attachment, RenderTargetObj _target)
+	{
+		AttachTexture(_attachment, _target->GetTexture(), _target->GetWidth(), _target->GetHeight());
+		ownedTargets.push_back(std::move(_target));
+	}
+
+	void Framebuffer::AttachRenderbuffer(GLenum _attachment, GLenum _internalFormat, int _width, int _height)
+	{
+		GLuint renderbuffer = 0;
+		GL_CHECK(glGenRenderbuffers(1, &renderbuffer));
+		renderbuffers.push_back(renderbuffer);
+
+		GL_CHECK(glBindRenderbuffer(GL_RENDERBUFFER, renderbuffer));
+		GL_CHECK(glRenderbufferStorage(GL_RENDERBUFFER, _internalFormat, _width, _height));
+		GL_CHECK(glBindRenderbuffer(GL_RENDERBUFFER, 0));
+
+		GL_CHECK(glBindFramebuffer(GL_FRAMEBUFFER, fbo));
+		GL_CHECK(glFramebufferRenderbuffer(GL_FRAMEBUFFER, _attachment, GL_RENDERBUFFER, renderbuffer));
+		GL_CHECK(glBindFramebuffer(GL_FRAMEBUFFER, 0));
+
+		TrackAttachment(_attachment, _width, _height);
+	}
+
+	void Framebuffer::CheckComplete()
+	{
+		GL_CHECK(glBindFramebuffer(GL_FRAMEBUFFER, fbo));
+		GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+		GL_CHECK(glBindFramebuffer(GL_FRAMEBUFFER, 0));
+
+		if (status != GL_FRAMEBUFFER_COMPLETE)
+		{
+			std::cerr << "Framebuffer incomplete, status: 0x" << std::hex << status << std::dec << std::endl;
+			throw std::runtime_error("Framebuffer Error");
+		}
+	}
+
+	void Framebuffer::Bind()
+	{
+		GL_CHECK(glBindFramebuffer(GL_FRAMEBUFFER, fbo));
+		if (drawBuffers.empty())
+		{
+			// Depth only pass
+			GL_CHECK(glDrawBuffer(GL_NONE));
+		}
+		else
+		{
+			GL_CHECK(glDrawBuffers(static_cast<GLsizei>(drawBuffers.size()), drawBuffers.data()));
+		}
+	}
+
+	void Framebuffer::BindDefault()
+	{
+		GL_CHECK(glBindFramebuffer(GL_FRAMEBUFFER, 0));
+	}
+
+	void Framebuffer::Invalidate(const std::vector<GLenum>& _attachments)
+	{
+		// glInvalidateFramebuffer is a GL 4.3 feature, on older contexts this is only a hint we can skip
+		if (_attachments.empty() || !(GLAD_GL_VERSION_4_3 || GLAD_GL_ARB_invalidate_subdata))
+		{
+			return;
+		}
+
+		GL_CHECK(glBindFramebuffer(GL_FRAMEBUFFER, fbo));
+		GL_CHECK(glInvalidateFramebuffer(GL_FRAMEBUFFER, static_cast<GLsizei>(_attachments.size()), _attachments.data()));
+	}
+
+	GLuint Framebuffer::GetTexture(GLenum _attachment) const
+	{
+		for (const auto& attachmentAndTexture : textures)
+		{
+			if (attachmentAndTexture.first == _attachment)
+			{
+				return attachmentAndTexture.second;
+			}
+		}
+		return 0;
+	}
+
+	void Framebuffer::TrackAttachment(GLenum _attachment, int _width, int _height)
+	{
+		if (_attachment >= GL_COLOR_ATTACHMENT0 && _attachment <= GL_COLOR_ATTACHMENT15)
+		{
+			// Keep draw buffers in attachment order so fragment output N writes to attachment N
+			drawBuffers.push_back(_attachment);
+			std::sort(drawBuffers.begin(), drawBuffers.end());
+		}
+
+		// The renderable area is the intersection of all attachments
+		width = (width == 0) ? _width : std::min(width, _width);
+		height = (height == 0) ? _height : std::min(height, _height);
+	}
+
+} // namespace GLW
@@ -1,8 +1,54 @@
 #include "GLW/GlWrap.h"
 
+#include <algorithm>
+
 namespace GLW
 {
 
+	namespace
+	{
+		// Calls are recorded once they have succeeded, so a trace never holds one which threw
+		using TraceCommand = TraceFormat::Command;
+
+		struct TextureFormat
+		{
+			GLenum internalFormat;
+			GLenum format;
+			// Makes one and two channel textures sample as grey and grey with alpha
+			const GLint* swizzle;
+		};
+
+		const GLint GreySwizzle[] = { GL_RED, GL_RED, GL_RED, GL_ONE };
+		const GLint GreyAlphaSwizzle[] = { GL_RED, GL_RED, GL_RED, GL_GREEN };
+
+		// The smallest storage which holds every channel the image has
+		TextureFormat ChooseTextureFormat(int _channels, bool _sRGB)
+		{
+			switch (_channels)
+			{
+			case 1:
+				return { GL_R8, GL_RED, GreySwizzle };
+			case 2:
+				return { GL_RG8, GL_RG, GreyAlphaSwizzle };
+			case 3:
+				return { static_cast<GLenum>(_sRGB ? GL_SRGB8 : GL_RGB8), GL_RGB, nullptr };
+			default:
+				return { static_cast<GLenum>(_sRGB ? GL_SRGB8_ALPHA8 : GL_RGBA8), GL_RGBA, nullptr };
+			}
+		}
+
+		// A full mip chain down to 1x1
+		GLsizei NumMipLevels(int _width, int _height)
+		{
+			GLsizei levels = 1;
+			for (int size = std::max(_width, _height); size > 1; size >>= 1)
+			{
+				++levels;
+			}
+			return levels;
+		}
+	}
+
 	GlWrap::GlWrap()
 	{
 
@@ -20,30 +66,134 @@ namespace GLW
 	void GlWrap::SetClearColor(float _red, float _green, float _blue, float _alpha)
 	{
 		GL_CHECK(glClearColor(_red, _green, _blue, _alpha));
+
+		TraceRecord(traceWriter.get(), TraceCommand::SetClearColor).Value(_red).Value(_green).Value(_blue).Value(_alpha);
 	}
 
 	void GlWrap::ClearFramebuffer()
 	{
 		GL_CHECK(glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT));
+
+		TraceRecord(traceWriter.get(), TraceCommand::ClearFramebuffer);
 	}
 
-	void GlWrap::LoadTexture(const std::string& _textureKey, const std::string& _imagePath)
+	void GlWrap::SetViewport(int _x, int _y, int _width, int _height)
 	{
-		auto result = textureMap.insert(std::make_pair(_textureKey, 0));
-		if (!result.second)
+		GL_CHECK(glViewport(_x, _y, _width, _height));
+
+		TraceRecord(traceWriter.get(), TraceCommand::SetViewport).Value<int32_t>(_x).Value<int32_t>(_y).Value<int32_t>(_width).Value<int32_t>(_height);
+	}
+
+	void GlWrap::StartTrace(const std::string& _tracePath, size_t _bufferSize)
+	{
+		if (traceWriter)
 		{
-			std::cerr << "Key already in use: " << result.first->first << std::endl;
-			throw std::runtime_error("Failed to load texture");
+			std::cerr << "Already tracing to " << traceWriter->GetPath() << std::endl;
+			throw std::runtime_error("GlWrap Error");
 		}
 
-		std::cout << "Loading image: " << _imagePath << std::endl;
+		traceWriter = TraceWriter::Make(_tracePath, _bufferSize);
+	}
+
+	void GlWrap::StopTrace()
+	{
+		if (traceWriter && traceWriter->GetNumStalls() > 0)
+		{
+			std::cerr << "Trace " << traceWriter->GetPath() << " waited for the writer thread "
+				<< traceWriter->GetNumStalls() << " times, consider a larger trace buffer" << std::endl;
+		}
+
+		traceWriter.reset();
+	}
+
+	void GlWrap::MarkFrame()
+	{
+		TraceRecord(traceWriter.get(), TraceCommand::EndFrame);
+	}
+
+	void GlWrap::CreateFramebuffer(const std::string& _framebufferKey, int _width, int _height,
+		const std::vector<GLenum>& _colorFormats, GLenum _depthFormat)
+	{
+		if (framebufferMap.find(_framebufferKey) != framebufferMap.end())
+		{
+			std::cerr << "Framebuffer key already in use: " << _framebufferKey << std::endl;
+			throw std::runtime_error("GlWrap Error");
+		}
+
+		// Only register the framebuffer once it is complete so a failed key can be retried
+		FramebufferObj framebuffer = Framebuffer::Make();
+		for (unsigned int i = 0; i < _colorFormats.size(); ++i)
+		{
+			framebuffer->AttachTarget(GL_COLOR_ATTACHMENT0 + i, RenderTarget::Make(_colorFormats[i], _width, _height));
+		}
+
+		if (_depthFormat != GL_NONE)
+		{
+			framebuffer->AttachRenderbuffer(RenderTarget::GetAttachmentPoint(_depthFormat, 0), _depthFormat, _width, _height);
+		}
+
+		framebuffer->CheckComplete();
+		framebufferMap.insert(std::make_pair(_framebufferKey, std::move(framebuffer)));
 
-		// Load texture
-		GL_CHECK((glGenTextures(1, &textureMap[_textureKey])));
-		GL_CHECK((glBindTexture(GL_TEXTURE_2D, textureMap[_textureKey])));
+		TraceRecord trace(traceWriter.get(), TraceCommand::CreateFramebuffer);
+		trace.String(_framebufferKey).Value<int32_t>(_width).Value<int32_t>(_height).Value(static_cast<uint32_t>(_colorFormats.size()));
+		for (auto colorFormat : _colorFormats)
+		{
+			trace.Value<uint32_t>(colorFormat);
+		}
+		trace.Value<uint32_t>(_depthFormat);
+	}
+
+	void GlWrap::BindFramebuffer(const std::string& _framebufferKey)
+	{
+		if (framebufferMap.find(_framebufferKey) == framebufferMap.end())
+		{
+			std::cerr << "Framebuffer key " << _framebufferKey << " not found in framebuffer map";
+			throw std::runtime_error("GlWrap error");
+		}
+
+		Framebuffer& framebuffer = *framebufferMap[_framebufferKey];
+		framebuffer.Bind();
+		GL_CHECK(glViewport(0, 0, framebuffer.GetWidth(), framebuffer.GetHeight()));
+
+		TraceRecord(traceWriter.get(), TraceCommand::BindFramebuffer).String(_framebufferKey);
+	}
 
-		int width, height;
-		unsigned char* image = SOIL_load_image(_imagePath.c_str(), &width, &height, 0, SOIL_LOAD_RGBA);
+	void GlWrap::BindDefaultFramebuffer(int _width, int _height)
+	{
+		Framebuffer::BindDefault();
+		GL_CHECK(glViewport(0, 0, _width, _height));
+
+		TraceRecord(traceWriter.get(), TraceCommand::BindDefaultFramebuffer).Value<int32_t>(_width).Value<int32_t>(_height);
+	}
+
+	void GlWrap::SetActiveFramebufferTexture(const std::string& _framebufferKey, unsigned int _colorIndex)
+	{
+		if (framebufferMap.find(_framebufferKey) == framebufferMap.end())
+		{
+			std::cerr << "Framebuffer key " << _framebufferKey << " not found in framebuffer map";
+			throw std::runtime_error("GlWrap error");
+		}
+
+		GLuint texture = framebufferMap[_framebufferKey]->GetTexture(GL_COLOR_ATTACHMENT0 + _colorIndex);
+		if (texture == 0)
+		{
+			std::cerr << "Framebuffer " << _framebufferKey << " has no colour attachment " << _colorIndex << std::endl;
+			throw std::runtime_error("GlWrap error");
+		}
+
+		GL_CHECK(glBindTexture(GL_TEXTURE_2D, texture));
+
+		TraceRecord(traceWriter.get(), TraceCommand::SetActiveFramebufferTexture).String(_framebufferKey).Value<uint32_t>(_colorIndex);
+	}
+
+	void GlWrap::LoadTexture(const std::string& _textureKey, const std::string& _imagePath, bool _sRGB)
+	{
+		std::cout << "Loading image: " << _imagePath << std::endl;
+
+		// Load the image with however many channels it has rather than expanding it to RGBA
+		int width, height, channels;
+		unsigned char* image = SOIL_load_image(_imagePath.c_str(), &width, &height, &channels, SOIL_LOAD_AUTO);
 
 		if (!image)
 		{
@@ -52,16 +202,93 @@ namespace GLW
 			throw std::runtime_error("Error loading image");
 		}
 
-		GL_CHECK(glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, image));
+		try
+		{
+			CreateTexture(_textureKey, width, height, channels, image, _sRGB);
+		}
+		catch (...)
+		{
+			SOIL_free_image_data(image);
+			throw;
+		}
 
 		SOIL_free_image_data(image);
+	}
 
-		GL_CHECK(glGenerateMipmap(GL_TEXTURE_2D));
+	void GlWrap::CreateTexture(const std::string& _textureKey, int _width, int _height, int _channels,
+		const unsigned char* _pixels, bool _sRGB)
+	{
+		if (textureMap.find(_textureKey) != textureMap.end())
+		{
+			std::cerr << "Key already in use: " << _textureKey << std::endl;
+			throw std::runtime_error("Failed to load texture");
+		}
+		if (_channels < 1 || _channels > 4 || _width <= 0 || _height <= 0)
+		{
+			std::cerr << "Cannot create texture " << _textureKey << " of " << _width << "x" << _height
+				<< " pixels with " << _channels << " channels" << std::endl;
+			throw std::runtime_error("Failed to load texture");
+		}
+
+		TextureFormat textureFormat = ChooseTextureFormat(_channels, _sRGB);
+		GLuint texture = 0;
+
+		// Rows of one, two and three channel images are not padded to four bytes
+		GL_CHECK(glPixelStorei(GL_UNPACK_ALIGNMENT, 1));
 
-		GL_CHECK(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_MIRRORED_REPEAT));
-		GL_CHECK(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_MIRRORED_REPEAT));
-		GL_CHECK(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR));
-		GL_CHECK(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR));
+		// The texture is only added to the map once it is complete, so a failure leaves nothing behind
+		try
+		{
+			if (Capabilities::DirectStateAccess())
+			{
+				// Immutable storage with every mip level allocated up front
+				GL_CHECK(glCreateTextures(GL_TEXTURE_2D, 1, &texture));
+				GL_CHECK(glTextureStorage2D(texture, NumMipLevels(_width, _height), textureFormat.internalFormat, _width, _height));
+				GL_CHECK(glTextureSubImage2D(texture, 0, 0, 0, _width, _height, textureFormat.format, GL_UNSIGNED_BYTE, _pixels));
+				GL_CHECK(glGenerateTextureMipmap(texture));
+
+				GL_CHECK(glTextureParameteri(texture, GL_TEXTURE_WRAP_S, GL_MIRRORED_REPEAT));
+				GL_CHECK(glTextureParameteri(texture, GL_TEXTURE_WRAP_T, GL_MIRRORED_REPEAT));
+				GL_CHECK(glTextureParameteri(texture, GL_TEXTURE_MIN_FILTER, GL_LINEAR));
+				GL_CHECK(glTextureParameteri(texture, GL_TEXTURE_MAG_FILTER, GL_LINEAR));
+				if (textureFormat.swizzle)
+				{
+					GL_CHECK(glTextureParameteriv(texture, GL_TEXTURE_SWIZZLE_RGBA, textureFormat.swizzle));
+				}
+			}
+			else
+			{
+				GL_CHECK((glGenTextures(1, &texture)));
+				GL_CHECK((glBindTexture(GL_TEXTURE_2D, texture)));
+
+				GL_CHECK(glTexImage2D(GL_TEXTURE_2D, 0, textureFormat.internalFormat, _width, _height, 0, textureFormat.format, GL_UNSIGNED_BYTE, _pixels));
+
+				GL_CHECK(glGenerateMipmap(GL_TEXTURE_2D));
+
+				GL_CHECK(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_MIRRORED_REPEAT));
+				GL_CHECK(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_MIRRORED_REPEAT));
+				GL_CHECK(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR));
+				GL_CHECK(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR));
+				if (textureFormat.swizzle)
+				{
+					GL_CHECK(glTexParameteriv(GL_TEXTURE_2D, GL_TEXTURE_SWIZZLE_RGBA, textureFormat.swizzle));
+				}
+			}
+
+			GL_CHECK(glPixelStorei(GL_UNPACK_ALIGNMENT, 4));
+		}
+		catch (...)
+		{
+			glDeleteTextures(1, &texture);
+			glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+			throw;
+		}
+
+		textureMap.insert(std::make_pair(_textureKey, texture));
+
+		TraceRecord(traceWriter.get(), TraceCommand::CreateTexture).String(_textureKey)
+			.Value<int32_t>(_width).Value<int32_t>(_height).Value<int32_t>(_channels).Value<uint8_t>(_sRGB)
+			.Blob(_pixels, static_cast<uint64_t>(_width) * _height * _channels);
 	}
 
 	void GlWrap::SetActiveTexture(const std::string& _textureKey)
@@ -75,6 +302,8 @@ namespace GLW
 
 		// Make texture active
 		GL_CHECK(glBindTexture(GL_TEXTURE_2D, textureMap[_textureKey]));
+
+		TraceRecord(traceWriter.get(), TraceCommand::SetActiveTexture).String(_textureKey);
 	}
 
 	void GlWrap::SetTextureUnit(int _unit)
@@ -89,6 +318,20 @@ namespace GLW
 			std::cerr << "Texture unit out of range" << std::endl;
 			throw std::runtime_error("GlWrap Error");
 		}
+
+		TraceRecord(traceWriter.get(), TraceCommand::SetTextureUnit).Value<int32_t>(_unit);
+	}
+
+	GLuint GlWrap::GetTexture(const std::string& _textureKey) const
+	{
+		auto texture = textureMap.find(_textureKey);
+		if (texture == textureMap.end())
+		{
+			std::cerr << "Texture key '" << _textureKey << "' not found in map" << std::endl;
+			throw std::runtime_error("GlWrap Error");
+		}
+
+		return texture->second;
 	}
 
 	void GlWrap::CreateVertexArray(const std::string& _VertexArrayKey,
@@ -103,6 +346,74 @@ namespace GLW
 			std::cerr << "VertexArray key already in use: " << result.first->first << std::endl;
 			throw std::runtime_error("GlWrap Error");
 		}
+
+		TraceRecord(traceWriter.get(), TraceCommand::CreateVertexArray).String(_VertexArrayKey)
+			.Blob(_vertices.data(), _vertices.size() * sizeof(float))
+			.Blob(_elements.data(), _elements.size() * sizeof(unsigned int))
+			.Layout(_attributeLayout);
+	}
+
+	void GlWrap::CreateVertexArray(const std::string& _vertexArrayKey,
+		const float* _vertices, size_t _numVertexValues,
+		const unsigned int* _elements, size_t _numElements,
+		const AttributeLayout& _attributeLayout)
+	{
+		if (vertexArrayMap.find(_vertexArrayKey) != vertexArrayMap.end())
+		{
+			std::cerr << "VertexArray key already in use: " << _vertexArrayKey << std::endl;
+			throw std::runtime_error("GlWrap Error");
+		}
+
+		vertexArrayMap[_vertexArrayKey] = VertexArray::Make(_vertices, _numVertexValues, _elements, _numElements, _attributeLayout);
+
+		TraceRecord(traceWriter.get(), TraceCommand::CreateVertexArray).String(_vertexArrayKey)
+			.Blob(_vertices, _numVertexValues * sizeof(float))
+			.Blob(_elements, _numElements * sizeof(unsigned int))
+			.Layout(_attributeLayout);
+	}
+
+	void GlWrap::CreateVertexArray(const std::string& _vertexArrayKey,
+		const std::vector<float>& _vertices,
+		const std::vector<unsigned int>& _elements,
+		const AttributeLayout& _attributeLayout,
+		const std::string& _bufferHeapKey)
+	{
+		if (bufferHeapMap.find(_bufferHeapKey) == bufferHeapMap.end())
+		{
+			std::cerr << "Buffer heap key " << _bufferHeapKey << " not found in buffer heap map" << std::endl;
+			throw std::runtime_error("GlWrap Error");
+		}
+		if (vertexArrayMap.find(_vertexArrayKey) != vertexArrayMap.end())
+		{
+			std::cerr << "VertexArray key already in use: " << _vertexArrayKey << std::endl;
+			throw std::runtime_error("GlWrap Error");
+		}
+
+		vertexArrayMap[_vertexArrayKey] = VertexArray::Make(*bufferHeapMap[_bufferHeapKey], _vertices, _elements, _attributeLayout);
+
+		TraceRecord(traceWriter.get(), TraceCommand::CreateHeapVertexArray).String(_vertexArrayKey)
+			.Blob(_vertices.data(), _vertices.size() * sizeof(float))
+			.Blob(_elements.data(), _elements.size() * sizeof(unsigned int))
+			.Layout(_attributeLayout)
+			.String(_bufferHeapKey);
+	}
+
+	void GlWrap::LoadMesh(const std::string& _vertexArrayKey, const std::string& _meshPath, size_t _lod)
+	{
+		if (vertexArrayMap.find(_vertexArrayKey) != vertexArrayMap.end())
+		{
+			std::cerr << "VertexArray key already in use: " << _vertexArrayKey << std::endl;
+			throw std::runtime_error("GlWrap Error");
+		}
+
+		std::cout << "Loading mesh: " << _meshPath << std::endl;
+
+		// The mapping only needs to live until the data has been uploaded. Going through
+		// CreateVertexArray means a trace holds the mesh data rather than the file path.
+		MeshFileObj mesh = MeshFile::Make(_meshPath);
+		const MeshLodView& lod = mesh->GetLod(_lod);
+		CreateVertexArray(_vertexArrayKey, lod.vertices, lod.numVertices * mesh->GetVertexStride(),
+			lod.indices, lod.numIndices, mesh->GetAttributeLayout());
 	}
 
 	void GlWrap::BindVertexArray(const std::string& _vertexArrayKey)
@@ -113,7 +424,20 @@ namespace GLW
 			throw std::runtime_error("GlWrap error");
 		}
 
-		vertexArrayMap[_vertexArrayKey]->Bind();
+		VertexArray& vertexArray = *vertexArrayMap[_vertexArrayKey];
+		vertexArray.Bind();
+		// A vertex array without a format binds its own vertex array object behind the cache's back
+		if (!vertexArray.GetVertexFormat())
+		{
+			vertexFormatCache.ForgetBinding();
+		}
+
+		TraceRecord(traceWriter.get(), TraceCommand::BindVertexArray).String(_vertexArrayKey);
+	}
+
+	void GlWrap::ForgetVertexArrayBinding()
+	{
+		vertexFormatCache.ForgetBinding();
 	}
 
 	void GlWrap::RenderVertexArray(const std::string& _vertexArrayKey)
@@ -125,6 +449,44 @@ namespace GLW
 		}
 
 		vertexArrayMap[_vertexArrayKey]->Render();
+
+		TraceRecord(traceWriter.get(), TraceCommand::RenderVertexArray).String(_vertexArrayKey);
+	}
+
+	void GlWrap::CreateBufferHeap(const std::string& _bufferHeapKey, uint64_t _capacity)
+	{
+		auto result = bufferHeapMap.insert(std::make_pair(_bufferHeapKey, BufferHeap::Make(_capacity)));
+		if (!result.second)
+		{
+			std::cerr << "Buffer heap key already in use: " << result.first->first << std::endl;
+			throw std::runtime_error("GlWrap Error");
+		}
+
+		TraceRecord(traceWriter.get(), TraceCommand::CreateBufferHeap).String(_bufferHeapKey).Value<uint64_t>(_capacity);
+	}
+
+	void GlWrap::DefragmentBufferHeap(const std::string& _bufferHeapKey)
+	{
+		if (bufferHeapMap.find(_bufferHeapKey) == bufferHeapMap.end())
+		{
+			std::cerr << "Buffer heap key " << _bufferHeapKey << " not found in buffer heap map" << std::endl;
+			throw std::runtime_error("GlWrap Error");
+		}
+
+		bufferHeapMap[_bufferHeapKey]->Defragment();
+
+		TraceRecord(traceWriter.get(), TraceCommand::DefragmentBufferHeap).String(_bufferHeapKey);
+	}
+
+	BufferHeap::Stats GlWrap::GetBufferHeapStats(const std::string& _bufferHeapKey)
+	{
+		if (bufferHeapMap.find(_bufferHeapKey) == bufferHeapMap.end())
+		{
+			std::cerr << "Buffer heap key " << _bufferHeapKey << " not found in buffer heap map" << std::endl;
+			throw std::runtime_error("GlWrap Error");
+		}
+
+		return bufferHeapMap[_bufferHeapKey]->GetStats();
 	}
 
 	void GlWrap::CreateUniformBuffer(const std::string& _uniformBufferName, unsigned int size, std::vector<std::string> _shaderKeyVector)
@@ -135,38 +497,219 @@ namespace GLW
 			shaderMap[_shaderKey]->BindToUniformBlock(_uniformBufferName, 0);
 		}
 
-		auto result = uniformBufferMap.insert(std::make_pair(_uniformBufferName, 0));
+		auto result = uniformBufferMap.insert(std::make_pair(_uniformBufferName, std::make_pair(0u, size)));
 		if (!result.second)
 		{
 			std::cerr << "Uniform buffer key already in use: " << result.first->first << std::endl;
 			throw std::runtime_error("GlWrap Error");
 		}
+		GLuint& uniformBuffer = result.first->second.first;
 
-		GL_CHECK(glGenBuffers(1, &uniformBufferMap[_uniformBufferName]));
+		if (Capabilities::DirectStateAccess())
+		{
+			GL_CHECK(glCreateBuffers(1, &uniformBuffer));
+			GL_CHECK(glNamedBufferStorage(uniformBuffer, size, NULL, GL_DYNAMIC_STORAGE_BIT));
+		}
+		else
+		{
+			GL_CHECK(glGenBuffers(1, &uniformBuffer));
+
+			GL_CHECK(glBindBuffer(GL_UNIFORM_BUFFER, uniformBuffer));
+			GL_CHECK(glBufferData(GL_UNIFORM_BUFFER, size, NULL, GL_STATIC_DRAW));
+			GL_CHECK(glBindBuffer(GL_UNIFORM_BUFFER, 0));
+		}
 
-		GL_CHECK(glBindBuffer(GL_UNIFORM_BUFFER, uniformBufferMap[_uniformBufferName]));
-		GL_CHECK(glBufferData(GL_UNIFORM_BUFFER, size, NULL, GL_STATIC_DRAW));
-		GL_CHECK(glBindBuffer(GL_UNIFORM_BUFFER, 0));
+		GL_CHECK(glBindBufferRange(GL_UNIFORM_BUFFER, 0, uniformBuffer, 0, size));
 
-		GL_CHECK(glBindBufferRange(GL_UNIFORM_BUFFER, 0, uniformBufferMap[_uniformBufferName], 0, size));
+		TraceRecord trace(traceWriter.get(), TraceCommand::CreateUniformBuffer);
+		trace.String(_uniformBufferName).Value<uint32_t>(size).Value(static_cast<uint32_t>(_shaderKeyVector.size()));
+		for (const auto& _shaderKey : _shaderKeyVector)
+		{
+			trace.String(_shaderKey);
+		}
 	}
 
 	void GlWrap::SetUniformBuffer(const std::string& _uniformBufferName, unsigned int _offset, glm::mat4 _value)
 	{
-		GL_CHECK(glBindBuffer(GL_UNIFORM_BUFFER, uniformBufferMap[_uniformBufferName]));
-		GL_CHECK(glBufferSubData(GL_UNIFORM_BUFFER, _offset, sizeof(glm::mat4), glm::value_ptr(_value)));
-		GL_CHECK(glBindBuffer(GL_UNIFORM_BUFFER, 0));
+		GLuint uniformBuffer = FindUniformBuffer(_uniformBufferName, _offset, sizeof(glm::mat4));
+
+		if (Capabilities::DirectStateAccess())
+		{
+			GL_CHECK(glNamedBufferSubData(uniformBuffer, _offset, sizeof(glm::mat4), glm::value_ptr(_value)));
+		}
+		else
+		{
+			GL_CHECK(glBindBuffer(GL_UNIFORM_BUFFER, uniformBuffer));
+			GL_CHECK(glBufferSubData(GL_UNIFORM_BUFFER, _offset, sizeof(glm::mat4), glm::value_ptr(_value)));
+			GL_CHECK(glBindBuffer(GL_UNIFORM_BUFFER, 0));
+		}
+
+		TraceRecord(traceWriter.get(), TraceCommand::SetUniformBuffer).String(_uniformBufferName).Value<uint32_t>(_offset).Value(_value);
+	}
+
+	void GlWrap::SetUniformBuffer(const std::string& _uniformBufferName, unsigned int _offset, unsigned int _size, const void* _data)
+	{
+		GLuint uniformBuffer = FindUniformBuffer(_uniformBufferName, _offset, _size);
+
+		if (Capabilities::DirectStateAccess())
+		{
+			GL_CHECK(glNamedBufferSubData(uniformBuffer, _offset, _size, _data));
+		}
+		else
+		{
+			GL_CHECK(glBindBuffer(GL_UNIFORM_BUFFER, uniformBuffer));
+			GL_CHECK(glBufferSubData(GL_UNIFORM_BUFFER, _offset, _size, _data));
+			GL_CHECK(glBindBuffer(GL_UNIFORM_BUFFER, 0));
+		}
+
+		TraceRecord(traceWriter.get(), TraceCommand::SetUniformBufferData).String(_uniformBufferName).Value<uint32_t>(_offset).Blob(_data, _size);
+	}
+
+	void GlWrap::SetUniformBuffer(const std::string& _uniformBufferName, unsigned int _offset,
+		TransformHierarchy& _transforms, const glm::mat4& _viewProjection)
+	{
+		unsigned int size = static_cast<unsigned int>(_transforms.GetSize() * sizeof(glm::mat4));
+
+		// The trace stores the matrices themselves so replaying it does not need the hierarchy
+		if (traceWriter)
+		{
+			std::vector<glm::mat4> matrices(_transforms.GetSize());
+			_transforms.WriteMatrices(matrices.data(), sizeof(glm::mat4), _viewProjection);
+			SetUniformBuffer(_uniformBufferName, _offset, size, matrices.data());
+			return;
+		}
+
+		UploadTransforms(FindUniformBuffer(_uniformBufferName, _offset, size), _offset, _transforms, _viewProjection);
+	}
+
+	void GlWrap::CreateStorageBuffer(const std::string& _storageBufferKey, unsigned int _size, const void* _data)
+	{
+		auto result = storageBufferMap.insert(std::make_pair(_storageBufferKey, ShaderStorageBuffer::Make(_size, _data)));
+		if (!result.second)
+		{
+			std::cerr << "Storage buffer key already in use: " << result.first->first << std::endl;
+			throw std::runtime_error("GlWrap Error");
+		}
+
+		TraceRecord(traceWriter.get(), TraceCommand::CreateStorageBuffer).String(_storageBufferKey).Value<uint32_t>(_size).Blob(_data, _data ? _size : 0);
+	}
+
+	void GlWrap::SetStorageBuffer(const std::string& _storageBufferKey, unsigned int _offset, unsigned int _size, const void* _data)
+	{
+		auto storageBuffer = storageBufferMap.find(_storageBufferKey);
+		if (storageBuffer == storageBufferMap.end())
+		{
+			std::cerr << "Storage buffer key '" << _storageBufferKey << "' not found in map" << std::endl;
+			throw std::runtime_error("GlWrap Error");
+		}
+
+		storageBuffer->second->Upload(_offset, _size, _data);
+
+		TraceRecord(traceWriter.get(), TraceCommand::SetStorageBuffer).String(_storageBufferKey).Value<uint32_t>(_offset).Blob(_data, _size);
+	}
+
+	void GlWrap::SetStorageBuffer(const std::string& _storageBufferKey, unsigned int _offset,
+		TransformHierarchy& _transforms, const glm::mat4& _viewProjection)
+	{
+		unsigned int size = static_cast<unsigned int>(_transforms.GetSize() * sizeof(glm::mat4));
+
+		// The trace stores the matrices themselves so replaying it does not need the hierarchy
+		if (traceWriter)
+		{
+			std::vector<glm::mat4> matrices(_transforms.GetSize());
+			_transforms.WriteMatrices(matrices.data(), sizeof(glm::mat4), _viewProjection);
+			SetStorageBuffer(_storageBufferKey, _offset, size, matrices.data());
+			return;
+		}
+
+		auto storageBuffer = storageBufferMap.find(_storageBufferKey);
+		if (storageBuffer == storageBufferMap.end())
+		{
+			std::cerr << "Storage buffer key '" << _storageBufferKey << "' not found in map" << std::endl;
+			throw std::runtime_error("GlWrap Error");
+		}
+
+		if (static_cast<GLsizeiptr>(_offset) + size > storageBuffer->second->GetSize())
+		{
+			std::cerr << "Writing " << size << " bytes of transforms at " << _offset << " overruns storage buffer "
+				<< _storageBufferKey << std::endl;
+			throw std::runtime_error("GlWrap Error");
+		}
+
+		UploadTransforms(storageBuffer->second->GetBuffer(), _offset, _transforms, _viewProjection);
+	}
+
+	void GlWrap::BindStorageBuffer(const std::string& _storageBufferKey, unsigned int _bindingPoint)
+	{
+		auto storageBuffer = storageBufferMap.find(_storageBufferKey);
+		if (storageBuffer == storageBufferMap.end())
+		{
+			std::cerr << "Storage buffer key '" << _storageBufferKey << "' not found in map" << std::endl;
+			throw std::runtime_error("GlWrap Error");
+		}
+
+		storageBuffer->second->BindBase(_bindingPoint);
+
+		TraceRecord(traceWriter.get(), TraceCommand::BindStorageBuffer).String(_storageBufferKey).Value<uint32_t>(_bindingPoint);
 	}
 
 	void GlWrap::CreateShader(const std::string& _shaderKey, const std::string& _vertPath, const std::string& _fragPath)
 	{
+		CreateShaderFromSource(_shaderKey, ShaderProgram::LoadShaderFromFile(_vertPath), ShaderProgram::LoadShaderFromFile(_fragPath));
+	}
+
+	void GlWrap::CreateShaderFromSource(const std::string& _shaderKey, const std::string& _vertSource, const std::string& _fragSource)
+	{
+		if (shaderMap.find(_shaderKey) != shaderMap.end())
+		{
+			std::cerr << "Shader key already in use: " << _shaderKey << std::endl;
+			throw std::runtime_error("GlWrap Error");
+		}
+
 		// Create a shader and insert it into the shader map
-		auto result = shaderMap.insert(std::make_pair(_shaderKey, ShaderProgram::Make(_vertPath, _fragPath)));
-		if (!result.second)
+		shaderMap[_shaderKey] = ShaderProgram::MakeFromSource(_vertSource, _fragSource);
+
+		TraceRecord(traceWriter.get(), TraceCommand::CreateShader).String(_shaderKey).Text(_vertSource).Text(_fragSource);
+	}
+
+	void GlWrap::CreateComputeShader(const std::string& _shaderKey, const std::string& _computePath)
+	{
+		CreateComputeShaderFromSource(_shaderKey, ShaderProgram::LoadShaderFromFile(_computePath));
+	}
+
+	void GlWrap::CreateComputeShaderFromSource(const std::string& _shaderKey, const std::string& _computeSource)
+	{
+		if (shaderMap.find(_shaderKey) != shaderMap.end())
 		{
-			std::cerr << "Shader key already in use: " << result.first->first << std::endl;
+			std::cerr << "Shader key already in use: " << _shaderKey << std::endl;
 			throw std::runtime_error("GlWrap Error");
 		}
+
+		shaderMap[_shaderKey] = ComputeProgram::MakeFromSource(_computeSource);
+
+		TraceRecord(traceWriter.get(), TraceCommand::CreateComputeShader).String(_shaderKey).Text(_computeSource);
+	}
+
+	void GlWrap::DispatchCompute(const std::string& _shaderKey, unsigned int _numGroupsX, unsigned int _numGroupsY, unsigned int _numGroupsZ)
+	{
+		auto shader = shaderMap.find(_shaderKey);
+		ComputeProgram* computeProgram = (shader == shaderMap.end()) ? nullptr : dynamic_cast<ComputeProgram*>(shader->second.get());
+		if (!computeProgram)
+		{
+			std::cerr << "Compute shader key '" << _shaderKey << "' not found in map" << std::endl;
+			throw std::runtime_error("GlWrap Error");
+		}
+
+		computeProgram->Dispatch(_numGroupsX, _numGroupsY, _numGroupsZ);
+
+		TraceRecord(traceWriter.get(), TraceCommand::DispatchCompute).String(_shaderKey).Value<uint32_t>(_numGroupsX).Value<uint32_t>(_numGroupsY).Value<uint32_t>(_numGroupsZ);
+	}
+
+	void GlWrap::InsertMemoryBarrier(GLbitfield _barriers)
+	{
+		ComputeProgram::Barrier(_barriers);
+
+		TraceRecord(traceWriter.get(), TraceCommand::InsertMemoryBarrier).Value<uint32_t>(_barriers);
 	}
 
 	void GlWrap::UseShader(const std::string& _shaderKey)
@@ -178,6 +721,8 @@ namespace GLW
 		}
 
 		shaderMap[_shaderKey]->Use();
+
+		TraceRecord(traceWriter.get(), TraceCommand::UseShader).String(_shaderKey);
 	}
 
 	void GlWrap::SpecifyAttributeLayout(const std::string& _shaderKey, const std::string& _vertexArryObjectKey)
@@ -195,8 +740,19 @@ namespace GLW
 			throw std::runtime_error("GlWrap Error");
 		}
 
-		AttributeLayout attributeLayout = vertexArrayMap[_vertexArryObjectKey]->GetAttributeLayout();
-		shaderMap[_shaderKey]->SpecifyAttributeLayout(attributeLayout);
+		VertexArray& vertexArray = *vertexArrayMap[_vertexArryObjectKey];
+		if (VertexFormat::IsSupported())
+		{
+			vertexArray.SetVertexFormat(&vertexFormatCache.Get(vertexArray.GetAttributeLayout(), *shaderMap[_shaderKey]));
+			// Rebind so the next draw goes through the format rather than the vertex array bound before
+			vertexArray.Bind();
+		}
+		else
+		{
+			vertexArray.SpecifyAttributeLayout(*shaderMap[_shaderKey]);
+		}
+
+		TraceRecord(traceWriter.get(), TraceCommand::SpecifyAttributeLayout).String(_shaderKey).String(_vertexArryObjectKey);
 	}
 
 	// Set int uniform
@@ -210,6 +766,8 @@ namespace GLW
 		}
 
 		shaderMap[_shaderKey]->SetUniform(_uniformKey, _value);
+
+		TraceRecord(traceWriter.get(), TraceCommand::SetUniformInt).String(_shaderKey).String(_uniformKey).Value<int32_t>(_value);
 	}
 
 	// Set float uniform
@@ -223,6 +781,8 @@ namespace GLW
 		}
 
 		shaderMap[_shaderKey]->SetUniform(_uniformKey, _value);
+
+		TraceRecord(traceWriter.get(), TraceCommand::SetUniformFloat).String(_shaderKey).String(_uniformKey).Value(_value);
 	}
 
 	// Set vec3 uniform
@@ -236,6 +796,8 @@ namespace GLW
 		}
 
 		shaderMap[_shaderKey]->SetUniform(_uniformKey, _value);
+
+		TraceRecord(traceWriter.get(), TraceCommand::SetUniformVec3).String(_shaderKey).String(_uniformKey).Value(_value);
 	}
 
 	// Set vec4 uniform
@@ -249,6 +811,8 @@ namespace GLW
 		}
 
 		shaderMap[_shaderKey]->SetUniform(_uniformKey, _value);
+
+		TraceRecord(traceWriter.get(), TraceCommand::SetUniformVec4).String(_shaderKey).String(_uniformKey).Value(_value);
 	}
 
 	// Set mat4 uniform
@@ -262,6 +826,45 @@ namespace GLW
 		}
 
 		shaderMap[_shaderKey]->SetUniform(_uniformKey, _value);
+
+		TraceRecord(traceWriter.get(), TraceCommand::SetUniformMat4).String(_shaderKey).String(_uniformKey).Value(_value);
+	}
+
+	GLuint GlWrap::FindUniformBuffer(const std::string& _uniformBufferName, unsigned int _offset, unsigned int _size) const
+	{
+		auto uniformBuffer = uniformBufferMap.find(_uniformBufferName);
+		if (uniformBuffer == uniformBufferMap.end())
+		{
+			std::cerr << "Uniform buffer key '" << _uniformBufferName << "' not found in map" << std::endl;
+			throw std::runtime_error("GlWrap Error");
+		}
+
+		if (static_cast<uint64_t>(_offset) + _size > uniformBuffer->second.second)
+		{
+			std::cerr << "Writing " << _size << " bytes at " << _offset << " overruns uniform buffer "
+				<< _uniformBufferName << " of " << uniformBuffer->second.second << " bytes" << std::endl;
+			throw std::runtime_error("GlWrap Error");
+		}
+
+		return uniformBuffer->second.first;
 	}
 
+	void GlWrap::UploadTransforms(GLuint _buffer, unsigned int _offset, TransformHierarchy& _transforms, const glm::mat4& _viewProjection)
+	{
+		GLsizeiptr size = static_cast<GLsizeiptr>(_transforms.GetSize() * sizeof(glm::mat4));
+		if (size == 0)
+		{
+			return;
+		}
+
+		// Grow in steps so a hierarchy which keeps gaining transforms does not recreate the ring every frame
+		if (!transformStaging || transformStaging->GetRegionSize() < size)
+		{
+			GLsizeiptr regionSize = transformStaging ? std::max(size, transformStaging->GetRegionSize() * 2) : size;
+			transformStaging = StreamingBuffer::Make(regionSize);
+		}
+
+		_transforms.WriteMatrices(transformStaging->Map(size), sizeof(glm::mat4), _viewProjection);
+		transformStaging->Copy(_buffer, _offset);
+	}
 }
\ No newline at end of file
@@ -0,0 +1,275 @@
+#include "GLW/GpuCulling.h"
+
+namespace GLW
+{
+
+	namespace
+	{
+		const char* CullingShaderSource = R"(
+#version 430
+layout(local_size_x = 64) in;
+
+struct Instance
+{
+	vec4 boundingSphere;
+	uint mesh;
+	uint padding0, padding1, padding2;
+};
+
+struct Mesh
+{
+	uint count;
+	uint firstIndex;
+	int baseVertex;
+	uint padding;
+};
+
+struct DrawCommand
+{
+	uint count;
+	uint instanceCount;
+	uint firstIndex;
+	int baseVertex;
+	uint baseInstance;
+};
+
+layout(std430, binding = 0) readonly buffer Instances { Instance instances[]; };
+layout(std430, binding = 1) readonly buffer Meshes { Mesh meshes[]; };
+layout(std430, binding = 2) writeonly buffer Commands { DrawCommand commands[]; };
+layout(std430, binding = 3) buffer Parameters { uint drawCount; };
+
+uniform vec4 frustumPlanes[6];
+uniform int numInstances;
+
+void main()
+{
+	uint index = gl_GlobalInvocationID.x;
+	if (index >= uint(numInstances))
+	{
+		return;
+	}
+
+	vec4 sphere = instances[index].boundingSphere;
+	for (int plane = 0; plane < 6; ++plane)
+	{
+		if (dot(frustumPlanes[plane].xyz, sphere.xyz) + frustumPlanes[plane].w < -sphere.w)
+		{
+			return;
+		}
+	}
+
+	Mesh mesh = meshes[instances[index].mesh];
+	uint slot = atomicAdd(drawCount, 1u);
+	commands[slot] = DrawCommand(mesh.count, 1u, mesh.firstIndex, mesh.baseVertex, index);
+}
+)";
+	}
+
+	GpuCulling::GpuCulling(uint32_t _maxInstances) :
+		maxInstances(_maxInstances), numInstances(0), instanceMeshes(_maxInstances, 0),
+		indirectCount(GLAD_GL_VERSION_4_6 || GLAD_GL_ARB_indirect_parameters)
+	{
+		if (_maxInstances == 0)
+		{
+			std::cerr << "GPU culling needs room for at least one instance" << std::endl;
+			throw std::runtime_error("GpuCulling Error");
+		}
+
+		// Draws find their instance through gl_BaseInstance, which GLSL only exposes with draw parameters
+		if (!GLAD_GL_VERSION_4_6 && !GLAD_GL_ARB_shader_draw_parameters)
+		{
+			std::cerr << "GPU culling needs OpenGL 4.6 or ARB_shader_draw_parameters" << std::endl;
+			throw std::runtime_error("GpuCulling Error");
+		}
+
+		program = ComputeProgram::MakeFromSource(CullingShaderSource);
+
+		instanceBuffer = ShaderStorageBuffer::Make(sizeof(Instance) * _maxInstances);
+		commandBuffer = ShaderStorageBuffer::Make(sizeof(DrawCommand) * _maxInstances);
+		parameterBuffer = ShaderStorageBuffer::Make(sizeof(GLuint));
+	}
+
+	GpuCulling::~GpuCulling()
+	{
+
+	}
+
+	void GpuCulling::SetMeshes(const std::vector<VertexArray*>& _meshes)
+	{
+		if (_meshes.empty())
+		{
+			std::cerr << "GPU culling needs at least one mesh" << std::endl;
+			throw std::runtime_error("GpuCulling Error");
+		}
+
+		std::vector<MeshInfo> meshInfos;
+		meshInfos.reserve(_meshes.size());
+		for (auto mesh : _meshes)
+		{
+			if (!mesh->IsHeapAllocated() || mesh->GetVertexHeap() != _meshes.front()->GetVertexHeap())
+			{
+				std::cerr << "GPU culled meshes must all be allocated from the same buffer heap" << std::endl;
+				throw std::runtime_error("GpuCulling Error");
+			}
+			// Draw binds a single element buffer, so the first index of every mesh must refer to it
+			if (mesh->GetElementBuffer() != _meshes.front()->GetElementBuffer())
+			{
+				std::cerr << "GPU culled meshes must all share the same index heap" << std::endl;
+				throw std::runtime_error("GpuCulling Error");
+			}
+			meshInfos.push_back({ static_cast<GLuint>(mesh->GetNumIndices()), mesh->GetFirstIndex(), mesh->GetBaseVertex(), 0 });
+		}
+
+		// Instances already uploaded must still refer to a mesh once the list shrinks
+		for (uint32_t i = 0; i < numInstances; ++i)
+		{
+			if (instanceMeshes[i] >= _meshes.size())
+			{
+				std::cerr << "Instance " << i << " uses mesh " << instanceMeshes[i] << " which is not in the "
+					<< _meshes.size() << " meshes being set" << std::endl;
+				throw std::runtime_error("GpuCulling Error");
+			}
+		}
+
+		GLsizeiptr size = static_cast<GLsizeiptr>(sizeof(MeshInfo) * meshInfos.size());
+		if (!meshBuffer || meshBuffer->GetSize() != size)
+		{
+			meshBuffer = ShaderStorageBuffer::Make(size, meshInfos.data());
+		}
+		else
+		{
+			meshBuffer->Upload(0, size, meshInfos.data());
+		}
+
+		meshes = _meshes;
+	}
+
+	void GpuCulling::SetInstances(const Instance* _instances, uint32_t _numInstances)
+	{
+		numInstances = 0;
+		UpdateInstances(0, _instances, _numInstances);
+		numInstances = _numInstances;
+	}
+
+	void GpuCulling::UpdateInstances(uint32_t _first, const Instance* _instances, uint32_t _numInstances)
+	{
+		if (_numInstances > maxInstances || _first > maxInstances - _numInstances)
+		{
+			std::cerr << "GPU culling was created for " << maxInstances << " instances, not "
+				<< static_cast<uint64_t>(_first) + _numInstances << std::endl;
+			throw std::runtime_error("GpuCulling Error");
+		}
+
+		// An out of range mesh index would read past the end of the mesh buffer on the GPU
+		for (uint32_t i = 0; i < _numInstances; ++i)
+		{
+			if (_instances[i].mesh >= meshes.size())
+			{
+				std::cerr << "Instance " << _first + i << " uses mesh " << _instances[i].mesh
+					<< " but only " << meshes.size() << " meshes are set" << std::endl;
+				throw std::runtime_error("GpuCulling Error");
+			}
+		}
+
+		for (uint32_t i = 0; i < _numInstances; ++i)
+		{
+			instanceMeshes[_first + i] = _instances[i].mesh;
+		}
+
+		if (_numInstances > 0)
+		{
+			instanceBuffer->Upload(sizeof(Instance) * _first, sizeof(Instance) * _numInstances, _instances);
+		}
+	}
+
+	void GpuCulling::Cull(const glm::mat4& _viewProjection)
+	{
+		if (numInstances == 0)
+		{
+			return;
+		}
+
+		// Gribb and Hartmann: each frustum plane is the sum or difference of the
+		// fourth row of the view projection matrix and one of the other rows
+		const glm::mat4& m = _viewProjection;
+		glm::vec4 rows[4];
+		for (int row = 0; row < 4; ++row)
+		{
+			rows[row] = glm::vec4(m[0][row], m[1][row], m[2][row], m[3][row]);
+		}
+
+		glm::vec4 planes[6] =
+		{
+			rows[3] + rows[0], rows[3] - rows[0],
+			rows[3] + rows[1], rows[3] - rows[1],
+			rows[3] + rows[2], rows[3] - rows[2]
+		};
+
+		program->Use();
+		for (int plane = 0; plane < 6; ++plane)
+		{
+			// Normalised so the plane distance can be compared with the sphere radius
+			planes[plane] = planes[plane] * (1.0f / glm::length(glm::vec3(planes[plane])));
+			program->SetUniform("frustumPlanes[" + std::to_string(plane) + "]", planes[plane]);
+		}
+		program->SetUniform("numInstances", static_cast<int>(numInstances));
+
+		parameterBuffer->Clear(0);
+		if (!indirectCount)
+		{
+			// Every slot is drawn, so the ones not written this frame must draw nothing
+			commandBuffer->Clear(0);
+		}
+
+		instanceBuffer->BindBase(InstanceBinding);
+		meshBuffer->BindBase(MeshBinding);
+		commandBuffer->BindBase(CommandBinding);
+		parameterBuffer->BindBase(ParameterBinding);
+
+		program->Dispatch(program->GetNumGroups(numInstances));
+
+		// The commands and draw count are read by the indirect draw, not by a shader
+		ComputeProgram::Barrier(GL_COMMAND_BARRIER_BIT);
+	}
+
+	void GpuCulling::Draw()
+	{
+		if (numInstances == 0)
+		{
+			return;
+		}
+
+		meshes.front()->Bind();
+		commandBuffer->Bind(GL_DRAW_INDIRECT_BUFFER);
+
+		if (indirectCount)
+		{
+			parameterBuffer->Bind(GL_PARAMETER_BUFFER);
+			if (GLAD_GL_VERSION_4_6)
+			{
+				GL_CHECK(glMultiDrawElementsIndirectCount(GL_TRIANGLES, GL_UNSIGNED_INT, nullptr, 0, numInstances, 0));
+			}
+			else
+			{
+				GL_CHECK(glMultiDrawElementsIndirectCountARB(GL_TRIANGLES, GL_UNSIGNED_INT, nullptr, 0, numInstances, 0));
+			}
+			GL_CHECK(glBindBuffer(GL_PARAMETER_BUFFER, 0));
+		}
+		else
+		{
+			GL_CHECK(glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, nullptr, numInstances, 0));
+		}
+
+		GL_CHECK(glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0));
+	}
+
+	uint32_t GpuCulling::ReadVisibleCount() const
+	{
+		ComputeProgram::Barrier(GL_BUFFER_UPDATE_BARRIER_BIT);
+
+		GLuint count = 0;
+		parameterBuffer->Download(0, sizeof(GLuint), &count);
+		return count;
+	}
+
+} // namespace GLW
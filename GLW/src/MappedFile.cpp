@@ -0,0 +1,106 @@
+#include "GLW/MappedFile.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace GLW
+{
+
+#ifdef _WIN32
+
+	MappedFile::MappedFile(const std::string& _path) :
+		path(_path), data(nullptr), size(0), file(INVALID_HANDLE_VALUE), mapping(nullptr)
+	{
+		file = CreateFileA(_path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+			OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+		if (file == INVALID_HANDLE_VALUE)
+		{
+			std::cerr << "Could not open file: " << _path << std::endl;
+			throw std::runtime_error("Could not map file");
+		}
+
+		LARGE_INTEGER fileSize;
+		if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0)
+		{
+			CloseHandle(file);
+			std::cerr << "File is empty or its size could not be read: " << _path << std::endl;
+			throw std::runtime_error("Could not map file");
+		}
+		size = static_cast<size_t>(fileSize.QuadPart);
+
+		mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+		if (mapping)
+		{
+			data = static_cast<const unsigned char*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+		}
+
+		if (!data)
+		{
+			if (mapping)
+			{
+				CloseHandle(mapping);
+			}
+			CloseHandle(file);
+			std::cerr << "Could not map file: " << _path << std::endl;
+			throw std::runtime_error("Could not map file");
+		}
+	}
+
+	MappedFile::~MappedFile()
+	{
+		UnmapViewOfFile(data);
+		CloseHandle(mapping);
+		CloseHandle(file);
+	}
+
+#else
+
+	MappedFile::MappedFile(const std::string& _path) :
+		path(_path), data(nullptr), size(0), file(-1)
+	{
+		file = open(_path.c_str(), O_RDONLY);
+		if (file == -1)
+		{
+			std::cerr << "Could not open file: " << _path << std::endl;
+			throw std::runtime_error("Could not map file");
+		}
+
+		struct stat fileStat;
+		if (fstat(file, &fileStat) != 0 || fileStat.st_size == 0)
+		{
+			close(file);
+			std::cerr << "File is empty or its size could not be read: " << _path << std::endl;
+			throw std::runtime_error("Could not map file");
+		}
+		size = static_cast<size_t>(fileStat.st_size);
+
+		void* mapped = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, file, 0);
+		if (mapped == MAP_FAILED)
+		{
+			close(file);
+			std::cerr << "Could not map file: " << _path << std::endl;
+			throw std::runtime_error("Could not map file");
+		}
+
+		// The whole file is about to be uploaded so ask for it to be read ahead
+		madvise(mapped, size, MADV_WILLNEED);
+		data = static_cast<const unsigned char*>(mapped);
+	}
+
+	MappedFile::~MappedFile()
+	{
+		munmap(const_cast<unsigned char*>(data), size);
+		close(file);
+	}
+
+#endif
+
+} // namespace GLW
@@ -0,0 +1,134 @@
+#include "GLW/MeshFile.h"
+#include "GLW/VertexArray.h"
+
+#include <cstring>
+
+namespace GLW
+{
+
+	MeshFile::MeshFile(const std::string& _path) :
+		file(MappedFile::Make(_path)), header(nullptr)
+	{
+		CheckRange(0, sizeof(MeshFormat::Header), "header");
+		header = reinterpret_cast<const MeshFormat::Header*>(file->GetData());
+
+		if (header->magic != MeshFormat::Magic)
+		{
+			std::cerr << "Not a GLW mesh file: " << _path << std::endl;
+			throw std::runtime_error("MeshFile Error");
+		}
+		if (header->version == 0 || header->version > MeshFormat::Version)
+		{
+			std::cerr << "Mesh file " << _path << " has version " << header->version
+				<< " but only versions up to " << MeshFormat::Version << " are supported" << std::endl;
+			throw std::runtime_error("MeshFile Error");
+		}
+		if (header->numAttributes == 0 || header->vertexStride == 0)
+		{
+			std::cerr << "Mesh file has no vertex attributes: " << _path << std::endl;
+			throw std::runtime_error("MeshFile Error");
+		}
+
+		// Attribute layout
+		CheckRange(header->attributeTableOffset, uint64_t(header->numAttributes) * sizeof(MeshFormat::Attribute), "attribute table");
+		const MeshFormat::Attribute* attributes =
+			reinterpret_cast<const MeshFormat::Attribute*>(file->GetData() + header->attributeTableOffset);
+
+		uint32_t stride = 0;
+		for (uint32_t i = 0; i < header->numAttributes; ++i)
+		{
+			const MeshFormat::Attribute& attribute = attributes[i];
+			size_t nameLength = strnlen(attribute.name, MeshFormat::MaxAttributeNameLength);
+			if (nameLength == MeshFormat::MaxAttributeNameLength || attribute.numValues == 0 || attribute.numValues > 4)
+			{
+				std::cerr << "Mesh file attribute " << i << " is malformed: " << _path << std::endl;
+				throw std::runtime_error("MeshFile Error");
+			}
+
+			attributeLayout.push_back(std::make_tuple(std::string(attribute.name, nameLength), static_cast<int>(attribute.numValues)));
+			stride += attribute.numValues;
+		}
+
+		if (stride != header->vertexStride)
+		{
+			std::cerr << "Mesh file vertex stride does not match its attributes: " << _path << std::endl;
+			throw std::runtime_error("MeshFile Error");
+		}
+
+		// Levels of detail
+		CheckRange(header->lodTableOffset, uint64_t(header->numLods) * sizeof(MeshFormat::Lod), "lod table");
+		const MeshFormat::Lod* fileLods =
+			reinterpret_cast<const MeshFormat::Lod*>(file->GetData() + header->lodTableOffset);
+
+		const uint64_t vertexSize = uint64_t(header->vertexStride) * sizeof(float);
+		for (uint32_t i = 0; i < header->numLods; ++i)
+		{
+			const MeshFormat::Lod& lod = fileLods[i];
+
+			if (lod.vertexOffset % MeshFormat::BlobAlignment != 0 || lod.indexOffset % MeshFormat::BlobAlignment != 0)
+			{
+				std::cerr << "Mesh file lod " << i << " blobs are not aligned: " << _path << std::endl;
+				throw std::runtime_error("MeshFile Error");
+			}
+
+			// Compare counts against the file size before multiplying so corrupt counts cannot overflow
+			if (lod.numVertices > file->GetSize() / vertexSize || lod.numIndices > file->GetSize() / sizeof(unsigned int))
+			{
+				std::cerr << "Mesh file lod " << i << " is larger than the file: " << _path << std::endl;
+				throw std::runtime_error("MeshFile Error");
+			}
+
+			CheckRange(lod.vertexOffset, lod.numVertices * vertexSize, "vertex blob");
+			CheckRange(lod.indexOffset, lod.numIndices * sizeof(unsigned int), "index blob");
+
+			lods.push_back({
+				reinterpret_cast<const float*>(file->GetData() + lod.vertexOffset),
+				static_cast<size_t>(lod.numVertices),
+				reinterpret_cast<const unsigned int*>(file->GetData() + lod.indexOffset),
+				static_cast<size_t>(lod.numIndices),
+				lod.error });
+		}
+	}
+
+	MeshFile::~MeshFile()
+	{
+
+	}
+
+	glm::vec3 MeshFile::GetBoundsMin() const
+	{
+		return glm::vec3(header->boundsMin[0], header->boundsMin[1], header->boundsMin[2]);
+	}
+
+	glm::vec3 MeshFile::GetBoundsMax() const
+	{
+		return glm::vec3(header->boundsMax[0], header->boundsMax[1], header->boundsMax[2]);
+	}
+
+	const MeshLodView& MeshFile::GetLod(size_t _lod) const
+	{
+		if (_lod >= lods.size())
+		{
+			std::cerr << "Mesh file " << file->GetPath() << " has no lod " << _lod << std::endl;
+			throw std::runtime_error("MeshFile Error");
+		}
+		return lods[_lod];
+	}
+
+	VertexArrayObj MeshFile::CreateVertexArray(size_t _lod) const
+	{
+		const MeshLodView& lod = GetLod(_lod);
+		return VertexArray::Make(lod.vertices, lod.numVertices * header->vertexStride,
+			lod.indices, lod.numIndices, attributeLayout);
+	}
+
+	void MeshFile::CheckRange(uint64_t _offset, uint64_t _size, const char* _what) const
+	{
+		if (_offset > file->GetSize() || _size > file->GetSize() - _offset)
+		{
+			std::cerr << "Mesh file " << _what << " lies outside the file: " << file->GetPath() << std::endl;
+			throw std::runtime_error("MeshFile Error");
+		}
+	}
+
+} // namespace GLW
@@ -0,0 +1,109 @@
+#include "GLW/MeshFile.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+
+// Writing lives in its own translation unit so offline tools can link it
+// without pulling in the OpenGL upload path
+
+namespace GLW
+{
+
+	void MeshFile::Write(const std::string& _path,
+		const AttributeLayout& _attributeLayout,
+		const glm::vec3& _boundsMin, const glm::vec3& _boundsMax,
+		const std::vector<MeshLodData>& _lods)
+	{
+		auto align = [](uint64_t _offset)
+		{
+			return (_offset + MeshFormat::BlobAlignment - 1) / MeshFormat::BlobAlignment * MeshFormat::BlobAlignment;
+		};
+
+		MeshFormat::Header header = {};
+		header.magic = MeshFormat::Magic;
+		header.version = MeshFormat::Version;
+		header.numAttributes = static_cast<uint32_t>(_attributeLayout.size());
+		header.numLods = static_cast<uint32_t>(_lods.size());
+		for (int i = 0; i < 3; ++i)
+		{
+			header.boundsMin[i] = _boundsMin[i];
+			header.boundsMax[i] = _boundsMax[i];
+		}
+
+		std::vector<MeshFormat::Attribute> attributes;
+		for (const auto& attributeAndNumValues : _attributeLayout)
+		{
+			const std::string& name = std::get<std::string>(attributeAndNumValues);
+			if (name.size() >= MeshFormat::MaxAttributeNameLength)
+			{
+				std::cerr << "Attribute name too long for a mesh file: " << name << std::endl;
+				throw std::runtime_error("MeshFile Error");
+			}
+
+			MeshFormat::Attribute attribute = {};
+			std::memcpy(attribute.name, name.c_str(), name.size());
+			attribute.numValues = static_cast<uint32_t>(std::get<int>(attributeAndNumValues));
+			attributes.push_back(attribute);
+			header.vertexStride += attribute.numValues;
+		}
+
+		header.attributeTableOffset = sizeof(MeshFormat::Header);
+		header.lodTableOffset = header.attributeTableOffset + attributes.size() * sizeof(MeshFormat::Attribute);
+
+		// Lay out the blobs after the tables, each one aligned
+		std::vector<MeshFormat::Lod> fileLods;
+		uint64_t offset = header.lodTableOffset + _lods.size() * sizeof(MeshFormat::Lod);
+		for (const auto& lod : _lods)
+		{
+			if (header.vertexStride == 0 || lod.vertices.size() % header.vertexStride != 0)
+			{
+				std::cerr << "Vertex data does not match the attribute layout: " << _path << std::endl;
+				throw std::runtime_error("MeshFile Error");
+			}
+
+			MeshFormat::Lod fileLod = {};
+			fileLod.vertexOffset = align(offset);
+			fileLod.numVertices = lod.vertices.size() / header.vertexStride;
+			fileLod.indexOffset = align(fileLod.vertexOffset + lod.vertices.size() * sizeof(float));
+			fileLod.numIndices = lod.indices.size();
+			fileLod.error = lod.error;
+			fileLods.push_back(fileLod);
+
+			offset = fileLod.indexOffset + lod.indices.size() * sizeof(unsigned int);
+		}
+
+		std::ofstream stream(_path, std::ios::binary);
+		if (!stream)
+		{
+			std::cerr << "Could not open mesh file for writing: " << _path << std::endl;
+			throw std::runtime_error("MeshFile Error");
+		}
+
+		auto writeAt = [&](uint64_t _offset, const void* _data, size_t _size)
+		{
+			static const char padding[MeshFormat::BlobAlignment] = {};
+			while (static_cast<uint64_t>(stream.tellp()) < _offset)
+			{
+				stream.write(padding, std::min<uint64_t>(_offset - stream.tellp(), sizeof(padding)));
+			}
+			stream.write(static_cast<const char*>(_data), _size);
+		};
+
+		writeAt(0, &header, sizeof(header));
+		writeAt(header.attributeTableOffset, attributes.data(), attributes.size() * sizeof(MeshFormat::Attribute));
+		writeAt(header.lodTableOffset, fileLods.data(), fileLods.size() * sizeof(MeshFormat::Lod));
+		for (size_t i = 0; i < _lods.size(); ++i)
+		{
+			writeAt(fileLods[i].vertexOffset, _lods[i].vertices.data(), _lods[i].vertices.size() * sizeof(float));
+			writeAt(fileLods[i].indexOffset, _lods[i].indices.data(), _lods[i].indices.size() * sizeof(unsigned int));
+		}
+
+		if (!stream)
+		{
+			std::cerr << "Could not write mesh file: " << _path << std::endl;
+			throw std::runtime_error("MeshFile Error");
+		}
+	}
+
+} // namespace GLW
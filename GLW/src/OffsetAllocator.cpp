@@ -0,0 +1,343 @@
+#include "GLW/OffsetAllocator.h"
+
+#include <cstring>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+namespace GLW
+{
+
+	namespace
+	{
+		uint32_t LowestSetBit(uint64_t _value)
+		{
+#if defined(_MSC_VER) && defined(_M_IX86)
+			// The 64 bit scans are only available when targeting x64 and ARM64
+			unsigned long index;
+			if (_BitScanForward(&index, static_cast<unsigned long>(_value)))
+			{
+				return index;
+			}
+			_BitScanForward(&index, static_cast<unsigned long>(_value >> 32));
+			return index + 32;
+#elif defined(_MSC_VER)
+			unsigned long index;
+			_BitScanForward64(&index, _value);
+			return index;
+#else
+			return static_cast<uint32_t>(__builtin_ctzll(_value));
+#endif
+		}
+
+		uint32_t HighestSetBit(uint64_t _value)
+		{
+#if defined(_MSC_VER) && defined(_M_IX86)
+			unsigned long index;
+			if (_BitScanReverse(&index, static_cast<unsigned long>(_value >> 32)))
+			{
+				return index + 32;
+			}
+			_BitScanReverse(&index, static_cast<unsigned long>(_value));
+			return index;
+#elif defined(_MSC_VER)
+			unsigned long index;
+			_BitScanReverse64(&index, _value);
+			return index;
+#else
+			return 63 - static_cast<uint32_t>(__builtin_clzll(_value));
+#endif
+		}
+	}
+
+	OffsetAllocator::OffsetAllocator(uint64_t _capacity) :
+		capacity(_capacity)
+	{
+		Reset();
+	}
+
+	OffsetAllocator::~OffsetAllocator()
+	{
+
+	}
+
+	OffsetAllocator::Allocation OffsetAllocator::Allocate(uint64_t _size, uint64_t _alignment)
+	{
+		if (_alignment == 0)
+		{
+			_alignment = 1;
+		}
+
+		const uint64_t size = (_size == 0 ? 1 : _size);
+
+		// The head of the bin for the exact size is usually suitable. If its aligned start does not
+		// leave room, fall back to a bin large enough for any start, which always fits.
+		uint32_t firstLevel, secondLevel;
+		uint32_t node = NoSpace;
+		if (FindBin(size, firstLevel, secondLevel))
+		{
+			uint32_t candidate = binHeads[firstLevel * SecondLevelCount + secondLevel];
+			if (AlignUp(nodes[candidate].offset, _alignment) - nodes[candidate].offset + size <= nodes[candidate].size)
+			{
+				node = candidate;
+			}
+		}
+
+		if (node == NoSpace)
+		{
+			if (_alignment - 1 > ~uint64_t(0) - size || !FindBin(size + _alignment - 1, firstLevel, secondLevel))
+			{
+				return { 0, NoSpace };
+			}
+			node = binHeads[firstLevel * SecondLevelCount + secondLevel];
+		}
+
+		RemoveFree(node);
+
+		// Padding in front of the aligned offset goes back to the free lists
+		uint64_t alignedOffset = AlignUp(nodes[node].offset, _alignment);
+		if (alignedOffset > nodes[node].offset)
+		{
+			uint32_t padding = node;
+			node = Split(padding, alignedOffset - nodes[padding].offset);
+			InsertFree(padding);
+		}
+
+		// As does whatever is left over after it
+		if (nodes[node].size > size)
+		{
+			InsertFree(Split(node, size));
+		}
+
+		nodes[node].used = true;
+		++numAllocations;
+		usedBytes += size;
+
+		return { alignedOffset, node };
+	}
+
+	void OffsetAllocator::Free(const Allocation& _allocation)
+	{
+		uint32_t node = _allocation.node;
+		if (node == NoSpace || node >= nodes.size() || !nodes[node].used)
+		{
+			return;
+		}
+
+		nodes[node].used = false;
+		--numAllocations;
+		usedBytes -= nodes[node].size;
+
+		// Merge with the free block before this one
+		uint32_t prev = nodes[node].neighbourPrev;
+		if (prev != NoSpace && !nodes[prev].used)
+		{
+			RemoveFree(prev);
+			nodes[prev].size += nodes[node].size;
+			nodes[prev].neighbourNext = nodes[node].neighbourNext;
+			if (nodes[node].neighbourNext != NoSpace)
+			{
+				nodes[nodes[node].neighbourNext].neighbourPrev = prev;
+			}
+			ReleaseNode(node);
+			node = prev;
+		}
+
+		// Merge with the free block after this one
+		uint32_t next = nodes[node].neighbourNext;
+		if (next != NoSpace && !nodes[next].used)
+		{
+			RemoveFree(next);
+			nodes[node].size += nodes[next].size;
+			nodes[node].neighbourNext = nodes[next].neighbourNext;
+			if (nodes[next].neighbourNext != NoSpace)
+			{
+				nodes[nodes[next].neighbourNext].neighbourPrev = node;
+			}
+			ReleaseNode(next);
+		}
+
+		InsertFree(node);
+	}
+
+	void OffsetAllocator::Reset()
+	{
+		nodes.clear();
+		unusedNodes.clear();
+		firstLevelBitmap = 0;
+		std::memset(secondLevelBitmaps, 0, sizeof(secondLevelBitmaps));
+		for (auto& head : binHeads)
+		{
+			head = NoSpace;
+		}
+		numAllocations = 0;
+		usedBytes = 0;
+
+		if (capacity > 0)
+		{
+			InsertFree(CreateNode(0, capacity));
+		}
+	}
+
+	OffsetAllocator::Stats OffsetAllocator::GetStats() const
+	{
+		Stats stats = { capacity, usedBytes, capacity - usedBytes, 0, numAllocations, 0 };
+
+		for (uint32_t bin = 0; bin < FirstLevelCount * SecondLevelCount; ++bin)
+		{
+			for (uint32_t node = binHeads[bin]; node != NoSpace; node = nodes[node].binNext)
+			{
+				++stats.numFreeBlocks;
+				if (nodes[node].size > stats.largestFreeBlock)
+				{
+					stats.largestFreeBlock = nodes[node].size;
+				}
+			}
+		}
+
+		return stats;
+	}
+
+	void OffsetAllocator::Mapping(uint64_t _size, uint32_t& _firstLevel, uint32_t& _secondLevel)
+	{
+		// Small sizes get a bin each, larger sizes split each power of two into SecondLevelCount bins
+		if (_size < SecondLevelCount)
+		{
+			_firstLevel = 0;
+			_secondLevel = static_cast<uint32_t>(_size);
+		}
+		else
+		{
+			uint32_t log2 = HighestSetBit(_size);
+			_firstLevel = log2 - SecondLevelLog2 + 1;
+			_secondLevel = static_cast<uint32_t>(_size >> (log2 - SecondLevelLog2)) & (SecondLevelCount - 1);
+		}
+	}
+
+	bool OffsetAllocator::FindBin(uint64_t _size, uint32_t& _firstLevel, uint32_t& _secondLevel) const
+	{
+		// Round up to the next bin so any block found is guaranteed to be large enough
+		if (_size >= SecondLevelCount)
+		{
+			uint64_t round = (uint64_t(1) << (HighestSetBit(_size) - SecondLevelLog2)) - 1;
+			if (_size > ~uint64_t(0) - round)
+			{
+				return false;
+			}
+			_size += round;
+		}
+		Mapping(_size, _firstLevel, _secondLevel);
+
+		uint32_t secondLevelMap = secondLevelBitmaps[_firstLevel] & (0xFFu << _secondLevel) & 0xFFu;
+		if (secondLevelMap == 0)
+		{
+			// Nothing in this size class, take the smallest bin of a larger class
+			uint64_t firstLevelMap = (_firstLevel + 1 < 64) ? firstLevelBitmap & (~uint64_t(0) << (_firstLevel + 1)) : 0;
+			if (firstLevelMap == 0)
+			{
+				return false;
+			}
+
+			_firstLevel = LowestSetBit(firstLevelMap);
+			secondLevelMap = secondLevelBitmaps[_firstLevel];
+		}
+
+		_secondLevel = LowestSetBit(secondLevelMap);
+		return true;
+	}
+
+	uint64_t OffsetAllocator::AlignUp(uint64_t _offset, uint64_t _alignment)
+	{
+		return (_offset + _alignment - 1) / _alignment * _alignment;
+	}
+
+	uint32_t OffsetAllocator::Split(uint32_t _node, uint64_t _size)
+	{
+		uint32_t remainder = CreateNode(nodes[_node].offset + _size, nodes[_node].size - _size);
+		nodes[remainder].neighbourPrev = _node;
+		nodes[remainder].neighbourNext = nodes[_node].neighbourNext;
+		if (nodes[_node].neighbourNext != NoSpace)
+		{
+			nodes[nodes[_node].neighbourNext].neighbourPrev = remainder;
+		}
+		nodes[_node].neighbourNext = remainder;
+		nodes[_node].size = _size;
+		return remainder;
+	}
+
+	uint32_t OffsetAllocator::CreateNode(uint64_t _offset, uint64_t _size)
+	{
+		uint32_t node;
+		if (!unusedNodes.empty())
+		{
+			node = unusedNodes.back();
+			unusedNodes.pop_back();
+		}
+		else
+		{
+			node = static_cast<uint32_t>(nodes.size());
+			nodes.emplace_back();
+		}
+
+		nodes[node] = { _offset, _size, NoSpace, NoSpace, NoSpace, NoSpace, false };
+		return node;
+	}
+
+	void OffsetAllocator::InsertFree(uint32_t _node)
+	{
+		uint32_t firstLevel, secondLevel;
+		Mapping(nodes[_node].size, firstLevel, secondLevel);
+		uint32_t bin = firstLevel * SecondLevelCount + secondLevel;
+
+		nodes[_node].binPrev = NoSpace;
+		nodes[_node].binNext = binHeads[bin];
+		if (binHeads[bin] != NoSpace)
+		{
+			nodes[binHeads[bin]].binPrev = _node;
+		}
+		binHeads[bin] = _node;
+
+		firstLevelBitmap |= uint64_t(1) << firstLevel;
+		secondLevelBitmaps[firstLevel] |= static_cast<uint8_t>(1u << secondLevel);
+	}
+
+	void OffsetAllocator::RemoveFree(uint32_t _node)
+	{
+		Node& node = nodes[_node];
+		if (node.binPrev != NoSpace)
+		{
+			nodes[node.binPrev].binNext = node.binNext;
+		}
+		if (node.binNext != NoSpace)
+		{
+			nodes[node.binNext].binPrev = node.binPrev;
+		}
+
+		uint32_t firstLevel, secondLevel;
+		Mapping(node.size, firstLevel, secondLevel);
+		uint32_t bin = firstLevel * SecondLevelCount + secondLevel;
+
+		if (binHeads[bin] == _node)
+		{
+			binHeads[bin] = node.binNext;
+			if (binHeads[bin] == NoSpace)
+			{
+				secondLevelBitmaps[firstLevel] &= static_cast<uint8_t>(~(1u << secondLevel));
+				if (secondLevelBitmaps[firstLevel] == 0)
+				{
+					firstLevelBitmap &= ~(uint64_t(1) << firstLevel);
+				}
+			}
+		}
+
+		node.binPrev = NoSpace;
+		node.binNext = NoSpace;
+	}
+
+	void OffsetAllocator::ReleaseNode(uint32_t _node)
+	{
+		unusedNodes.push_back(_node);
+	}
+
+} // namespace GLW
@@ -0,0 +1,206 @@
+#include "GLW/PixelReadback.h"
+
+namespace GLW
+{
+
+	PixelReadback::PixelReadback(unsigned int _numBuffers) :
+		head(0), numPending(0), numReads(0), numStalls(0)
+	{
+		if (_numBuffers == 0)
+		{
+			std::cerr << "Pixel readback needs at least one buffer" << std::endl;
+			throw std::runtime_error("PixelReadback Error");
+		}
+
+		slots.resize(_numBuffers);
+		for (auto& slot : slots)
+		{
+			GL_CHECK(glGenBuffers(1, &slot.buffer));
+			slot.capacity = 0;
+			slot.fence = nullptr;
+		}
+	}
+
+	PixelReadback::~PixelReadback()
+	{
+		for (auto& slot : slots)
+		{
+			if (slot.fence)
+			{
+				glDeleteSync(slot.fence);
+			}
+			glDeleteBuffers(1, &slot.buffer);
+		}
+	}
+
+	void PixelReadback::Read(int _x, int _y, int _width, int _height, GLenum _format, GLenum _type, ReadbackCallback _callback)
+	{
+		if (_width <= 0 || _height <= 0)
+		{
+			std::cerr << "Pixel readback area must not be empty: " << _width << "x" << _height << std::endl;
+			throw std::runtime_error("PixelReadback Error");
+		}
+
+		// Every buffer is in flight so the oldest read has to finish before its buffer can be reused
+		if (numPending == slots.size())
+		{
+			++numStalls;
+			Complete(GL_TIMEOUT_IGNORED);
+		}
+
+		Slot& slot = slots[(head + numPending) % slots.size()];
+		size_t size = static_cast<size_t>(_width) * _height * GetBytesPerPixel(_format, _type);
+
+		GL_CHECK(glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.buffer));
+		if (size > slot.capacity)
+		{
+			GL_CHECK(glBufferData(GL_PIXEL_PACK_BUFFER, size, nullptr, GL_STREAM_READ));
+			slot.capacity = size;
+		}
+
+		// Rows are tightly packed so the consumer does not need to know about row alignment
+		GLint packAlignment;
+		GL_CHECK(glGetIntegerv(GL_PACK_ALIGNMENT, &packAlignment));
+		GL_CHECK(glPixelStorei(GL_PACK_ALIGNMENT, 1));
+		GL_CHECK(glReadPixels(_x, _y, _width, _height, _format, _type, nullptr));
+		GL_CHECK(glPixelStorei(GL_PACK_ALIGNMENT, packAlignment));
+		GL_CHECK(glBindBuffer(GL_PIXEL_PACK_BUFFER, 0));
+
+		GL_CHECK(slot.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0));
+		slot.info = { _x, _y, _width, _height, _format, _type, size, numReads++ };
+		slot.callback = std::move(_callback);
+		++numPending;
+	}
+
+	std::future<std::vector<unsigned char>> PixelReadback::Read(int _x, int _y, int _width, int _height, GLenum _format, GLenum _type)
+	{
+		// std::function must be copyable so the promise is shared rather than moved into the callback
+		auto promise = std::make_shared<std::promise<std::vector<unsigned char>>>();
+		std::future<std::vector<unsigned char>> future = promise->get_future();
+
+		Read(_x, _y, _width, _height, _format, _type, [promise](const unsigned char* _pixels, const ReadbackInfo& _info)
+		{
+			promise->set_value(std::vector<unsigned char>(_pixels, _pixels + _info.size));
+		});
+
+		return future;
+	}
+
+	void PixelReadback::Poll()
+	{
+		while (numPending > 0 && Complete(0))
+		{
+		}
+	}
+
+	void PixelReadback::Flush()
+	{
+		while (numPending > 0)
+		{
+			Complete(GL_TIMEOUT_IGNORED);
+		}
+	}
+
+	size_t PixelReadback::GetBytesPerPixel(GLenum _format, GLenum _type)
+	{
+		size_t numComponents;
+		switch (_format)
+		{
+		case GL_RED:
+		case GL_GREEN:
+		case GL_BLUE:
+		case GL_DEPTH_COMPONENT:
+		case GL_STENCIL_INDEX:
+			numComponents = 1; break;
+		case GL_RG:
+			numComponents = 2; break;
+		case GL_RGB:
+		case GL_BGR:
+			numComponents = 3; break;
+		case GL_RGBA:
+		case GL_BGRA:
+			numComponents = 4; break;
+		default:
+			std::cerr << "Unsupported readback format: 0x" << std::hex << _format << std::dec << std::endl;
+			throw std::runtime_error("PixelReadback Error");
+		}
+
+		switch (_type)
+		{
+		case GL_UNSIGNED_BYTE:
+		case GL_BYTE:
+			return numComponents;
+		case GL_UNSIGNED_SHORT:
+		case GL_SHORT:
+		case GL_HALF_FLOAT:
+			return numComponents * 2;
+		case GL_UNSIGNED_INT:
+		case GL_INT:
+		case GL_FLOAT:
+			return numComponents * 4;
+		default:
+			std::cerr << "Unsupported readback type: 0x" << std::hex << _type << std::dec << std::endl;
+			throw std::runtime_error("PixelReadback Error");
+		}
+	}
+
+	bool PixelReadback::Complete(GLuint64 _timeout)
+	{
+		Slot& slot = slots[head];
+
+		// Flushing makes sure the fence actually reaches the GPU, otherwise waiting on it could never return
+		GLenum result = glClientWaitSync(slot.fence, GL_SYNC_FLUSH_COMMANDS_BIT, _timeout);
+		if (result == GL_TIMEOUT_EXPIRED)
+		{
+			return false;
+		}
+		if (result == GL_WAIT_FAILED)
+		{
+			CheckOpenGLError("glClientWaitSync", __FILE__, __LINE__);
+			throw std::runtime_error("PixelReadback Error");
+		}
+
+		glDeleteSync(slot.fence);
+		slot.fence = nullptr;
+
+		const ReadbackInfo info = slot.info;
+		ReadbackCallback callback = std::move(slot.callback);
+		slot.callback = nullptr;
+
+		// The copy has finished so mapping does not block
+		GL_CHECK(glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.buffer));
+		const unsigned char* pixels = static_cast<const unsigned char*>(
+			glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, info.size, GL_MAP_READ_BIT));
+
+		if (!pixels)
+		{
+			GL_CHECK(glBindBuffer(GL_PIXEL_PACK_BUFFER, 0));
+			head = (head + 1) % slots.size();
+			--numPending;
+			std::cerr << "Could not map pixel buffer for readback " << info.index << std::endl;
+			throw std::runtime_error("PixelReadback Error");
+		}
+
+		// Free the slot even if the callback throws so the ring stays consistent
+		try
+		{
+			callback(pixels, info);
+		}
+		catch (...)
+		{
+			glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+			glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+			head = (head + 1) % slots.size();
+			--numPending;
+			throw;
+		}
+
+		GL_CHECK(glUnmapBuffer(GL_PIXEL_PACK_BUFFER));
+		GL_CHECK(glBindBuffer(GL_PIXEL_PACK_BUFFER, 0));
+		head = (head + 1) % slots.size();
+		--numPending;
+
+		return true;
+	}
+
+} // namespace GLW
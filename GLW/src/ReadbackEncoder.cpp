@@ -0,0 +1,144 @@
+#include "GLW/ReadbackEncoder.h"
+
+#include <cstring>
+#include <fstream>
+
+#include <SOIL2/SOIL2.h>
+
+namespace GLW
+{
+
+	ReadbackEncoder::ReadbackEncoder(Encoding _encoding, size_t _maxQueuedFrames) :
+		encoding(_encoding), maxQueuedFrames(_maxQueuedFrames == 0 ? 1 : _maxQueuedFrames),
+		busy(false), stopping(false), numFailures(0)
+	{
+		worker = std::thread(&ReadbackEncoder::Run, this);
+	}
+
+	ReadbackEncoder::~ReadbackEncoder()
+	{
+		// Finish writing whatever has been submitted before stopping
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			stopping = true;
+		}
+		jobAdded.notify_all();
+		worker.join();
+	}
+
+	void ReadbackEncoder::Submit(std::vector<unsigned char> _pixels, const ReadbackInfo& _info, const std::string& _path)
+	{
+		if (_info.width <= 0 || _info.height <= 0 || _pixels.empty())
+		{
+			std::cerr << "Readback image must not be empty: " << _path << std::endl;
+			throw std::runtime_error("ReadbackEncoder Error");
+		}
+
+		bool pngFormat = _info.format == GL_RED || _info.format == GL_RG || _info.format == GL_RGB || _info.format == GL_RGBA;
+		if (encoding == Encoding::Png && (_info.type != GL_UNSIGNED_BYTE || !pngFormat))
+		{
+			std::cerr << "PNG encoding needs GL_UNSIGNED_BYTE RED, RG, RGB or RGBA pixels: " << _path << std::endl;
+			throw std::runtime_error("ReadbackEncoder Error");
+		}
+
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			jobTaken.wait(lock, [this]() { return jobs.size() < maxQueuedFrames; });
+			jobs.push_back({ std::move(_pixels), _info, _path });
+		}
+		jobAdded.notify_one();
+	}
+
+	PixelReadback::ReadbackCallback ReadbackEncoder::MakeCallback(const std::string& _pathPrefix)
+	{
+		const std::string extension = (encoding == Encoding::Png) ? ".png" : ".raw";
+		return [this, _pathPrefix, extension](const unsigned char* _pixels, const ReadbackInfo& _info)
+		{
+			// The mapped pointer is only valid during the callback so this is the one copy we need
+			Submit(std::vector<unsigned char>(_pixels, _pixels + _info.size), _info,
+				_pathPrefix + std::to_string(_info.index) + extension);
+		};
+	}
+
+	void ReadbackEncoder::Wait()
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+		idle.wait(lock, [this]() { return jobs.empty() && !busy; });
+	}
+
+	unsigned long long ReadbackEncoder::GetNumFailures()
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		return numFailures;
+	}
+
+	void ReadbackEncoder::Run()
+	{
+		for (;;)
+		{
+			Job job;
+			{
+				std::unique_lock<std::mutex> lock(mutex);
+				jobAdded.wait(lock, [this]() { return !jobs.empty() || stopping; });
+				if (jobs.empty())
+				{
+					return;
+				}
+
+				job = std::move(jobs.front());
+				jobs.pop_front();
+				busy = true;
+			}
+			jobTaken.notify_one();
+
+			bool encoded = Encode(job);
+
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				busy = false;
+				numFailures += encoded ? 0 : 1;
+			}
+			idle.notify_all();
+		}
+	}
+
+	bool ReadbackEncoder::Encode(Job& _job)
+	{
+		if (encoding == Encoding::Raw)
+		{
+			std::ofstream file(_job.path, std::ios::binary);
+			file.write(reinterpret_cast<const char*>(_job.pixels.data()), _job.pixels.size());
+			if (!file)
+			{
+				std::cerr << "Could not write readback file: " << _job.path << std::endl;
+				return false;
+			}
+			return true;
+		}
+
+		const int width = _job.info.width;
+		const int height = _job.info.height;
+		const size_t rowSize = _job.pixels.size() / height;
+		const int channels = static_cast<int>(rowSize / width);
+
+		// glReadPixels returns the bottom row first, images are stored top row first
+		std::vector<unsigned char> row(rowSize);
+		for (int y = 0; y < height / 2; ++y)
+		{
+			unsigned char* top = &_job.pixels[y * rowSize];
+			unsigned char* bottom = &_job.pixels[(height - 1 - y) * rowSize];
+			std::memcpy(row.data(), top, rowSize);
+			std::memcpy(top, bottom, rowSize);
+			std::memcpy(bottom, row.data(), rowSize);
+		}
+
+		if (!SOIL_save_image(_job.path.c_str(), SOIL_SAVE_TYPE_PNG, width, height, channels, _job.pixels.data()))
+		{
+			std::cerr << "Could not write readback image: " << _job.path << std::endl;
+			std::cerr << "SOIL error: " << SOIL_last_result() << std::endl;
+			return false;
+		}
+		return true;
+	}
+
+} // namespace GLW
@@ -0,0 +1,116 @@
+#include "GLW/RenderTargetPool.h"
+
+namespace GLW
+{
+
+	RenderTargetPool::RenderTargetPool(unsigned int _maxIdleFrames) :
+		frame(0), maxIdleFrames(_maxIdleFrames)
+	{
+
+	}
+
+	RenderTargetPool::~RenderTargetPool()
+	{
+
+	}
+
+	RenderTarget* RenderTargetPool::Acquire(const RenderTargetDesc& _desc)
+	{
+		std::vector<Entry>& entries = entryMap[_desc];
+
+		for (auto& entry : entries)
+		{
+			if (!entry.inUse)
+			{
+				entry.inUse = true;
+				entry.lastUsedFrame = frame;
+				return entry.target.get();
+			}
+		}
+
+		entries.push_back({ RenderTarget::Make(_desc.internalFormat, _desc.width, _desc.height), true, frame });
+		return entries.back().target.get();
+	}
+
+	void RenderTargetPool::Release(RenderTarget* _target)
+	{
+		RenderTargetDesc desc = { _target->GetInternalFormat(), _target->GetWidth(), _target->GetHeight() };
+
+		auto entries = entryMap.find(desc);
+		if (entries != entryMap.end())
+		{
+			for (auto& entry : entries->second)
+			{
+				if (entry.target.get() == _target)
+				{
+					entry.inUse = false;
+					entry.lastUsedFrame = frame;
+					return;
+				}
+			}
+		}
+
+		std::cerr << "Render target " << _target->GetTexture() << " was not acquired from this pool" << std::endl;
+		throw std::runtime_error("RenderTargetPool Error");
+	}
+
+	void RenderTargetPool::EndFrame(std::vector<GLuint>* _evicted)
+	{
+		++frame;
+		Evict(maxIdleFrames, _evicted);
+	}
+
+	void RenderTargetPool::Trim(std::vector<GLuint>* _evicted)
+	{
+		Evict(0, _evicted);
+	}
+
+	size_t RenderTargetPool::GetNumTargets() const
+	{
+		size_t numTargets = 0;
+		for (const auto& descAndEntries : entryMap)
+		{
+			numTargets += descAndEntries.second.size();
+		}
+		return numTargets;
+	}
+
+	size_t RenderTargetPool::GetNumTargetsInUse() const
+	{
+		size_t numTargets = 0;
+		for (const auto& descAndEntries : entryMap)
+		{
+			for (const auto& entry : descAndEntries.second)
+			{
+				numTargets += entry.inUse ? 1 : 0;
+			}
+		}
+		return numTargets;
+	}
+
+	void RenderTargetPool::Evict(unsigned int _maxIdleFrames, std::vector<GLuint>* _evicted)
+	{
+		for (auto descAndEntries = entryMap.begin(); descAndEntries != entryMap.end();)
+		{
+			std::vector<Entry>& entries = descAndEntries->second;
+			for (auto entry = entries.begin(); entry != entries.end();)
+			{
+				if (!entry->inUse && frame - entry->lastUsedFrame >= _maxIdleFrames)
+				{
+					if (_evicted)
+					{
+						_evicted->push_back(entry->target->GetTexture());
+					}
+					entry = entries.erase(entry);
+				}
+				else
+				{
+					++entry;
+				}
+			}
+
+			descAndEntries = entries.empty() ? entryMap.erase(descAndEntries) : std::next(descAndEntries);
+		}
+	}
+
+} // namespace GLW
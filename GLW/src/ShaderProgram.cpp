@@ -3,16 +3,27 @@
 namespace GLW
 {
 
-    ShaderProgram::ShaderProgram(const std::string& _vertexShaderPath, const std::string& _fragmentShaderPath)
+    ShaderProgram::ShaderProgram(const std::string& _vertexShaderPath, const std::string& _fragmentShaderPath) :
+        ShaderProgram()
+    {
+        Link(LoadShaderFromFile(_vertexShaderPath), LoadShaderFromFile(_fragmentShaderPath));
+    }
+
+    ShaderProgram::ShaderProgram() :
+        shaderProgram(0), vertexShader(0), fragmentShader(0)
     {
 
+    }
+
+    void ShaderProgram::Link(const std::string& _vertexSource, const std::string& _fragmentSource)
+    {
         GL_CHECK(shaderProgram = glCreateProgram());
 
         // Create and compile the vertex shader
-        CompileShader(vertexShader, GL_VERTEX_SHADER, LoadShaderFromFile(_vertexShaderPath));
+        CompileShader(vertexShader, GL_VERTEX_SHADER, _vertexSource);
 
         // Create and compile the fragment shader
-        CompileShader(fragmentShader, GL_FRAGMENT_SHADER, LoadShaderFromFile(_fragmentShaderPath));
+        CompileShader(fragmentShader, GL_FRAGMENT_SHADER, _fragmentSource);
 
         // Link the vertex and fragment shader into a shader program
         GL_CHECK(glAttachShader(shaderProgram, vertexShader));
@@ -20,6 +31,8 @@ namespace GLW
         GL_CHECK(glBindFragDataLocation(shaderProgram, 0, "outColor"));
         GL_CHECK(glLinkProgram(shaderProgram));
         GL_CHECK(glUseProgram(shaderProgram));
+
+        ResolveAttributeLocations();
     }
 
     ShaderProgram::~ShaderProgram()
@@ -137,16 +150,15 @@ namespace GLW
     void ShaderProgram::SpecifyAttributeLayout(const AttributeLayout& _attributeLayout)
     {
         int layoutSize = 0;
-        for (auto attributeAndNumValues : _attributeLayout)
+        for (const auto& attributeAndNumValues : _attributeLayout)
         {
             layoutSize += std::get<int>(attributeAndNumValues);
         }
 
         int currentPosition = 0;
-        for (auto attributeAndNumValues : _attributeLayout)
+        for (const auto& attributeAndNumValues : _attributeLayout)
         {
-            const char* name = std::get<std::string>(attributeAndNumValues).c_str();
-            GLint attribLocation = GL_CHECK(glGetAttribLocation(shaderProgram, name));
+            GLint attribLocation = GetAttributeLocation(std::get<std::string>(attributeAndNumValues));
             if (attribLocation != -1)
             {
                 GL_CHECK(glEnableVertexAttribArray(attribLocation));
@@ -160,12 +172,52 @@ namespace GLW
         }
     }
 
+    GLint ShaderProgram::GetAttributeLocation(const std::string& _attributeName) const
+    {
+        auto attribute = attributeLocationMap.find(_attributeName);
+        return (attribute == attributeLocationMap.end()) ? -1 : attribute->second;
+    }
+
     void ShaderProgram::BindToUniformBlock(const std::string& _uniformBlockName, unsigned int _bindingPoint)
     {
         unsigned int uniformBlockIndex = glGetUniformBlockIndex(shaderProgram, _uniformBlockName.c_str());
         glUniformBlockBinding(shaderProgram, uniformBlockIndex, _bindingPoint);
     }
 
+    void ShaderProgram::BindToStorageBlock(const std::string& _storageBlockName, unsigned int _bindingPoint)
+    {
+        GLuint storageBlockIndex = glGetProgramResourceIndex(shaderProgram, GL_SHADER_STORAGE_BLOCK, _storageBlockName.c_str());
+        if (storageBlockIndex == GL_INVALID_INDEX)
+        {
+            std::cerr << "Storage block " << _storageBlockName << " not found in shader program" << std::endl;
+            throw std::runtime_error("Shader error");
+        }
+        GL_CHECK(glShaderStorageBlockBinding(shaderProgram, storageBlockIndex, _bindingPoint));
+    }
+
+    void ShaderProgram::ResolveAttributeLocations()
+    {
+        attributeLocationMap.clear();
+
+        GLint numAttributes = 0;
+        GLint maxNameLength = 0;
+        GL_CHECK(glGetProgramiv(shaderProgram, GL_ACTIVE_ATTRIBUTES, &numAttributes));
+        GL_CHECK(glGetProgramiv(shaderProgram, GL_ACTIVE_ATTRIBUTE_MAX_LENGTH, &maxNameLength));
+
+        std::vector<GLchar> name(maxNameLength + 1);
+        for (GLint i = 0; i < numAttributes; ++i)
+        {
+            GLsizei nameLength = 0;
+            GLint size = 0;
+            GLenum type = 0;
+            GL_CHECK(glGetActiveAttrib(shaderProgram, i, static_cast<GLsizei>(name.size()), &nameLength, &size, &type, &name[0]));
+
+            // Built in inputs such as gl_VertexID are reported with a location of -1
+            GLint location = GL_CHECK(glGetAttribLocation(shaderProgram, &name[0]));
+            attributeLocationMap[std::string(&name[0], nameLength)] = location;
+        }
+    }
+
     std::string ShaderProgram::LoadShaderFromFile(const std::string& _filename)
     {
         std::ifstream file;
@@ -0,0 +1,74 @@
+#include "GLW/ShaderStorageBuffer.h"
+
+namespace GLW
+{
+
+	ShaderStorageBuffer::ShaderStorageBuffer(GLsizeiptr _size, const void* _data) :
+		buffer(0), size(_size)
+	{
+		GL_CHECK(glGenBuffers(1, &buffer));
+		GL_CHECK(glBindBuffer(GL_SHADER_STORAGE_BUFFER, buffer));
+
+		if (Capabilities::BufferStorage())
+		{
+			GL_CHECK(glBufferStorage(GL_SHADER_STORAGE_BUFFER, _size, _data, GL_DYNAMIC_STORAGE_BIT));
+		}
+		else
+		{
+			GL_CHECK(glBufferData(GL_SHADER_STORAGE_BUFFER, _size, _data, GL_DYNAMIC_DRAW));
+		}
+
+		GL_CHECK(glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0));
+	}
+
+	ShaderStorageBuffer::~ShaderStorageBuffer()
+	{
+		glDeleteBuffers(1, &buffer);
+	}
+
+	void ShaderStorageBuffer::Upload(GLintptr _offset, GLsizeiptr _size, const void* _data)
+	{
+		if (_offset < 0 || _offset + _size > size)
+		{
+			std::cerr << "Upload of " << _size << " bytes at " << _offset << " overruns a storage buffer of "
+				<< size << " bytes" << std::endl;
+			throw std::runtime_error("ShaderStorageBuffer Error");
+		}
+
+		GL_CHECK(glBindBuffer(GL_COPY_WRITE_BUFFER, buffer));
+		GL_CHECK(glBufferSubData(GL_COPY_WRITE_BUFFER, _offset, _size, _data));
+		GL_CHECK(glBindBuffer(GL_COPY_WRITE_BUFFER, 0));
+	}
+
+	void ShaderStorageBuffer::Download(GLintptr _offset, GLsizeiptr _size, void* _data) const
+	{
+		if (_offset < 0 || _offset + _size > size)
+		{
+			std::cerr << "Download of " << _size << " bytes at " << _offset << " overruns a storage buffer of "
+				<< size << " bytes" << std::endl;
+			throw std::runtime_error("ShaderStorageBuffer Error");
+		}
+
+		GL_CHECK(glBindBuffer(GL_COPY_READ_BUFFER, buffer));
+		GL_CHECK(glGetBufferSubData(GL_COPY_READ_BUFFER, _offset, _size, _data));
+		GL_CHECK(glBindBuffer(GL_COPY_READ_BUFFER, 0));
+	}
+
+	void ShaderStorageBuffer::Clear(GLuint _value)
+	{
+		GL_CHECK(glBindBuffer(GL_COPY_WRITE_BUFFER, buffer));
+		GL_CHECK(glClearBufferData(GL_COPY_WRITE_BUFFER, GL_R32UI, GL_RED_INTEGER, GL_UNSIGNED_INT, &_value));
+		GL_CHECK(glBindBuffer(GL_COPY_WRITE_BUFFER, 0));
+	}
+
+	void ShaderStorageBuffer::BindBase(GLuint _bindingPoint) const
+	{
+		GL_CHECK(glBindBufferBase(GL_SHADER_STORAGE_BUFFER, _bindingPoint, buffer));
+	}
+
+	void ShaderStorageBuffer::Bind(GLenum _target) const
+	{
+		GL_CHECK(glBindBuffer(_target, buffer));
+	}
+
+} // namespace GLW
@@ -0,0 +1,449 @@
+#include "GLW/SpriteBatch.h"
+
+#include <algorithm>
+#include <cmath>
+#include <string>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+	#define GLW_SPRITE_BATCH_SSE2
+	#include <emmintrin.h>
+#endif
+
+namespace GLW
+{
+
+	namespace
+	{
+		const char* SpriteVertexSource = R"(
+#version 330 core
+layout(location = 0) in vec2 position;
+layout(location = 1) in vec2 texCoord;
+layout(location = 2) in vec4 color;
+layout(location = 3) in uint slot;
+
+uniform mat4 viewProjection;
+
+out vec2 fragTexCoord;
+out vec4 fragColor;
+flat out uint fragSlot;
+
+void main()
+{
+	fragTexCoord = texCoord;
+	fragColor = color;
+	fragSlot = slot;
+	gl_Position = viewProjection * vec4(position, 0.0, 1.0);
+}
+)";
+
+		// Samplers may only be indexed with a constant before GL 4.0 (and a dynamically
+		// uniform value after), so each slot is selected by a branch. Must have one case
+		// for each of SpriteBatch::MaxTextureSlots.
+		const char* SpriteFragmentSource = R"(
+#version 330 core
+in vec2 fragTexCoord;
+in vec4 fragColor;
+flat in uint fragSlot;
+
+uniform sampler2D textures[8];
+
+out vec4 outColor;
+
+vec4 SampleSlot(uint slot, vec2 uv)
+{
+	switch (slot)
+	{
+	case 0u: return texture(textures[0], uv);
+	case 1u: return texture(textures[1], uv);
+	case 2u: return texture(textures[2], uv);
+	case 3u: return texture(textures[3], uv);
+	case 4u: return texture(textures[4], uv);
+	case 5u: return texture(textures[5], uv);
+	case 6u: return texture(textures[6], uv);
+	default: return texture(textures[7], uv);
+	}
+}
+
+void main()
+{
+	outColor = SampleSlot(fragSlot, fragTexCoord) * fragColor;
+}
+)";
+
+		// Two triangles per quad with corners in the order written by WriteQuads
+		template <typename Index>
+		std::vector<Index> MakeQuadIndices(uint32_t _numQuads)
+		{
+			std::vector<Index> indices(static_cast<size_t>(_numQuads) * 6);
+			for (uint32_t quad = 0; quad < _numQuads; ++quad)
+			{
+				Index first = static_cast<Index>(quad * 4);
+				Index* index = &indices[static_cast<size_t>(quad) * 6];
+				index[0] = first;
+				index[1] = first + 1;
+				index[2] = first + 2;
+				index[3] = first + 2;
+				index[4] = first + 3;
+				index[5] = first;
+			}
+			return indices;
+		}
+
+		// A batch of sprites drawn by one draw call
+		struct Batch
+		{
+			uint32_t first;
+			uint32_t numSprites;
+			GLuint textures[SpriteBatch::MaxTextureSlots];
+			uint32_t numTextures;
+		};
+	}
+
+	SpriteBatch::SpriteBatch(uint32_t _maxSprites, unsigned int _numRegions) :
+		maxSprites(_maxSprites), vao(0), indexBuffer(0), indexType(GL_UNSIGNED_INT),
+		drawing(false), sortMode(SortMode::Texture), boundTextures{},
+		numSpritesDrawn(0), numDrawCalls(0)
+	{
+		// Each region must fit in the buffer with room to spare in a GLsizeiptr on 32 bit builds
+		if (_maxSprites == 0 || _numRegions == 0 || _maxSprites > (1u << 20))
+		{
+			std::cerr << "Sprite batch needs between 1 and " << (1u << 20) << " sprites and at least one region" << std::endl;
+			throw std::runtime_error("SpriteBatch Error");
+		}
+
+		shader = ShaderProgram::MakeFromSource(SpriteVertexSource, SpriteFragmentSource);
+		for (unsigned int slot = 0; slot < MaxTextureSlots; ++slot)
+		{
+			shader->SetUniform("textures[" + std::to_string(slot) + "]", static_cast<int>(slot));
+		}
+
+		// Every draw starts at a base vertex, so 16 bit indices cover regions of up to 16384 sprites
+		std::vector<GLushort> shortIndices;
+		std::vector<GLuint> intIndices;
+		const void* indices;
+		GLsizeiptr indexSize;
+		if (_maxSprites * 4 <= 65536)
+		{
+			shortIndices = MakeQuadIndices<GLushort>(_maxSprites);
+			indices = shortIndices.data();
+			indexSize = shortIndices.size() * sizeof(GLushort);
+			indexType = GL_UNSIGNED_SHORT;
+		}
+		else
+		{
+			intIndices = MakeQuadIndices<GLuint>(_maxSprites);
+			indices = intIndices.data();
+			indexSize = intIndices.size() * sizeof(GLuint);
+			indexType = GL_UNSIGNED_INT;
+		}
+
+		// Every write to the stream starts on a whole vertex as long as its 16 byte alignment divides a quad
+		static_assert(sizeof(Vertex) * 4 % 16 == 0, "Sprite quads must keep stream writes vertex aligned");
+		vertexStream = StreamingBuffer::Make(static_cast<GLsizeiptr>(sizeof(Vertex)) * 4 * _maxSprites, _numRegions);
+
+		if (Capabilities::DirectStateAccess())
+		{
+			GL_CHECK(glCreateBuffers(1, &indexBuffer));
+			GL_CHECK(glNamedBufferStorage(indexBuffer, indexSize, indices, 0));
+
+			GL_CHECK(glCreateVertexArrays(1, &vao));
+			GL_CHECK(glVertexArrayVertexBuffer(vao, 0, vertexStream->GetBuffer(), 0, sizeof(Vertex)));
+			GL_CHECK(glVertexArrayElementBuffer(vao, indexBuffer));
+
+			GL_CHECK(glVertexArrayAttribFormat(vao, 0, 2, GL_FLOAT, GL_FALSE, offsetof(Vertex, x)));
+			GL_CHECK(glVertexArrayAttribFormat(vao, 1, 2, GL_FLOAT, GL_FALSE, offsetof(Vertex, u)));
+			GL_CHECK(glVertexArrayAttribFormat(vao, 2, 4, GL_UNSIGNED_BYTE, GL_TRUE, offsetof(Vertex, color)));
+			GL_CHECK(glVertexArrayAttribIFormat(vao, 3, 1, GL_UNSIGNED_INT, offsetof(Vertex, slot)));
+			for (GLuint location = 0; location < 4; ++location)
+			{
+				GL_CHECK(glVertexArrayAttribBinding(vao, location, 0));
+				GL_CHECK(glEnableVertexArrayAttrib(vao, location));
+			}
+		}
+		else
+		{
+			GL_CHECK(glGenVertexArrays(1, &vao));
+			GL_CHECK(glBindVertexArray(vao));
+
+			GL_CHECK(glGenBuffers(1, &indexBuffer));
+			GL_CHECK(glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBuffer));
+			GL_CHECK(glBufferData(GL_ELEMENT_ARRAY_BUFFER, indexSize, indices, GL_STATIC_DRAW));
+
+			// The attribute pointers capture the array buffer binding
+			GL_CHECK(glBindBuffer(GL_ARRAY_BUFFER, vertexStream->GetBuffer()));
+
+			GL_CHECK(glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, x)));
+			GL_CHECK(glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, u)));
+			GL_CHECK(glVertexAttribPointer(2, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(Vertex), (void*)offsetof(Vertex, color)));
+			GL_CHECK(glVertexAttribIPointer(3, 1, GL_UNSIGNED_INT, sizeof(Vertex), (void*)offsetof(Vertex, slot)));
+			for (GLuint location = 0; location < 4; ++location)
+			{
+				GL_CHECK(glEnableVertexAttribArray(location));
+			}
+			GL_CHECK(glBindBuffer(GL_ARRAY_BUFFER, 0));
+		}
+	}
+
+	SpriteBatch::~SpriteBatch()
+	{
+		glDeleteVertexArrays(1, &vao);
+		glDeleteBuffers(1, &indexBuffer);
+	}
+
+	void SpriteBatch::Begin(const glm::mat4& _viewProjection, SortMode _sortMode)
+	{
+		if (drawing)
+		{
+			std::cerr << "SpriteBatch::Begin called again before End" << std::endl;
+			throw std::runtime_error("SpriteBatch Error");
+		}
+
+		// Each frame writes to a fresh region so it never waits on the frame the GPU is drawing
+		vertexStream->NextRegion();
+
+		drawing = true;
+		sortMode = _sortMode;
+		std::fill(std::begin(boundTextures), std::end(boundTextures), 0);
+		numSpritesDrawn = 0;
+		numDrawCalls = 0;
+
+		shader->Use();
+		shader->SetUniform("viewProjection", _viewProjection);
+	}
+
+	void SpriteBatch::Draw(const Sprite& _sprite)
+	{
+		if (!drawing)
+		{
+			std::cerr << "SpriteBatch::Draw called outside Begin and End" << std::endl;
+			throw std::runtime_error("SpriteBatch Error");
+		}
+
+		sprites.push_back(_sprite);
+		if (sprites.size() == maxSprites)
+		{
+			Flush();
+		}
+	}
+
+	void SpriteBatch::Draw(const Sprite* _sprites, size_t _numSprites)
+	{
+		if (!drawing)
+		{
+			std::cerr << "SpriteBatch::Draw called outside Begin and End" << std::endl;
+			throw std::runtime_error("SpriteBatch Error");
+		}
+
+		while (_numSprites > 0)
+		{
+			size_t numToAdd = std::min(_numSprites, static_cast<size_t>(maxSprites) - sprites.size());
+			sprites.insert(sprites.end(), _sprites, _sprites + numToAdd);
+			_sprites += numToAdd;
+			_numSprites -= numToAdd;
+
+			if (sprites.size() == maxSprites)
+			{
+				Flush();
+			}
+		}
+	}
+
+	void SpriteBatch::End()
+	{
+		if (!drawing)
+		{
+			std::cerr << "SpriteBatch::End called without Begin" << std::endl;
+			throw std::runtime_error("SpriteBatch Error");
+		}
+
+		Flush();
+		drawing = false;
+		GL_CHECK(glActiveTexture(GL_TEXTURE0));
+	}
+
+	void SpriteBatch::Flush()
+	{
+		uint32_t numSprites = static_cast<uint32_t>(sprites.size());
+		if (numSprites == 0)
+		{
+			return;
+		}
+
+		// Sorting 64 bit keys is much cheaper than moving the sprites themselves
+		sortKeys.resize(numSprites);
+		for (uint32_t i = 0; i < numSprites; ++i)
+		{
+			sortKeys[i] = (sortMode == SortMode::Texture) ? (static_cast<uint64_t>(sprites[i].texture) << 32) | i : i;
+		}
+		if (sortMode == SortMode::Texture)
+		{
+			std::sort(sortKeys.begin(), sortKeys.end());
+		}
+
+		std::vector<const Sprite*> ordered(numSprites);
+		std::vector<uint32_t> slots(numSprites);
+		std::vector<Batch> batches(1, Batch{});
+
+		// Give each texture a slot in the current batch, starting another batch once they run out
+		GLuint lastTexture = 0;
+		uint32_t lastSlot = MaxTextureSlots;
+		for (uint32_t i = 0; i < numSprites; ++i)
+		{
+			const Sprite& sprite = sprites[static_cast<uint32_t>(sortKeys[i])];
+			ordered[i] = &sprite;
+
+			if (lastSlot == MaxTextureSlots || sprite.texture != lastTexture)
+			{
+				Batch* batch = &batches.back();
+				lastSlot = static_cast<uint32_t>(std::find(batch->textures, batch->textures + batch->numTextures, sprite.texture) - batch->textures);
+				if (lastSlot == batch->numTextures)
+				{
+					if (batch->numTextures == MaxTextureSlots)
+					{
+						batches.push_back(Batch{});
+						batches.back().first = i;
+						batch = &batches.back();
+						lastSlot = 0;
+					}
+					batch->textures[batch->numTextures++] = sprite.texture;
+				}
+				lastTexture = sprite.texture;
+			}
+
+			slots[i] = lastSlot;
+			++batches.back().numSprites;
+		}
+
+		WriteQuads(ordered.data(), slots.data(), numSprites,
+			static_cast<Vertex*>(vertexStream->Map(static_cast<GLsizeiptr>(numSprites) * 4 * sizeof(Vertex))));
+		vertexStream->Unmap();
+		GLint firstVertex = static_cast<GLint>(vertexStream->GetMappedOffset() / static_cast<GLintptr>(sizeof(Vertex)));
+
+		GL_CHECK(glBindVertexArray(vao));
+		shader->Use();
+
+		for (const Batch& batch : batches)
+		{
+			for (uint32_t slot = 0; slot < batch.numTextures; ++slot)
+			{
+				if (boundTextures[slot] != batch.textures[slot])
+				{
+					GL_CHECK(glActiveTexture(GL_TEXTURE0 + slot));
+					GL_CHECK(glBindTexture(GL_TEXTURE_2D, batch.textures[slot]));
+					boundTextures[slot] = batch.textures[slot];
+				}
+			}
+
+			// Indices restart at zero for each batch and the base vertex moves them to its quads
+			GLint baseVertex = firstVertex + static_cast<GLint>(batch.first * 4);
+			GL_CHECK(glDrawElementsBaseVertex(GL_TRIANGLES, static_cast<GLsizei>(batch.numSprites * 6), indexType, nullptr, baseVertex));
+			++numDrawCalls;
+		}
+
+		numSpritesDrawn += numSprites;
+		sprites.clear();
+	}
+
+	void SpriteBatch::WriteQuads(const Sprite* const* _sprites, const uint32_t* _slots, size_t _numSprites, Vertex* _vertices)
+	{
+#ifdef GLW_SPRITE_BATCH_SSE2
+		// Corner offsets in the order bottom left, bottom right, top right, top left
+		const __m128 cornerX = _mm_setr_ps(-0.5f, 0.5f, 0.5f, -0.5f);
+		const __m128 cornerY = _mm_setr_ps(-0.5f, -0.5f, 0.5f, 0.5f);
+		const __m128 zero = _mm_setzero_ps();
+		const __m128 one = _mm_set1_ps(1.0f);
+		const __m128 maxByte = _mm_set1_ps(255.0f);
+
+		for (size_t i = 0; i < _numSprites; ++i)
+		{
+			const Sprite& sprite = *_sprites[i];
+			Vertex* vertex = _vertices + i * 4;
+
+			// Most sprites are not rotated, so avoid the trigonometry for them
+			float cosine = 1.0f;
+			float sine = 0.0f;
+			if (sprite.rotation != 0.0f)
+			{
+				cosine = std::cos(sprite.rotation);
+				sine = std::sin(sprite.rotation);
+			}
+
+			// Rotate all four corners at once
+			__m128 offsetX = _mm_mul_ps(cornerX, _mm_set1_ps(sprite.size.x));
+			__m128 offsetY = _mm_mul_ps(cornerY, _mm_set1_ps(sprite.size.y));
+			__m128 cos4 = _mm_set1_ps(cosine);
+			__m128 sin4 = _mm_set1_ps(sine);
+			__m128 x = _mm_add_ps(_mm_set1_ps(sprite.position.x), _mm_sub_ps(_mm_mul_ps(offsetX, cos4), _mm_mul_ps(offsetY, sin4)));
+			__m128 y = _mm_add_ps(_mm_set1_ps(sprite.position.y), _mm_add_ps(_mm_mul_ps(offsetX, sin4), _mm_mul_ps(offsetY, cos4)));
+			__m128 xy01 = _mm_unpacklo_ps(x, y);
+			__m128 xy23 = _mm_unpackhi_ps(x, y);
+
+			// uvRect is u0 v0 u1 v1, the corners need u0 v0 u1 v0 and u1 v1 u0 v1
+			__m128 uvRect = _mm_loadu_ps(&sprite.uvRect.x);
+			__m128 uv01 = _mm_shuffle_ps(uvRect, uvRect, _MM_SHUFFLE(1, 2, 1, 0));
+			__m128 uv23 = _mm_shuffle_ps(uvRect, uvRect, _MM_SHUFFLE(3, 0, 3, 2));
+
+			// Clamp, scale and round the colour then narrow it to four bytes
+			__m128 color = _mm_mul_ps(_mm_min_ps(_mm_max_ps(_mm_loadu_ps(&sprite.color.x), zero), one), maxByte);
+			__m128i color32 = _mm_cvtps_epi32(color);
+			__m128i color16 = _mm_packs_epi32(color32, color32);
+			uint32_t packedColor = static_cast<uint32_t>(_mm_cvtsi128_si32(_mm_packus_epi16(color16, color16)));
+
+			// Every byte of each vertex is written in order, which suits write combined mapped memory
+			_mm_storel_pi(reinterpret_cast<__m64*>(&vertex[0].x), xy01);
+			_mm_storel_pi(reinterpret_cast<__m64*>(&vertex[0].u), uv01);
+			vertex[0].color = packedColor;
+			vertex[0].slot = _slots[i];
+			_mm_storeh_pi(reinterpret_cast<__m64*>(&vertex[1].x), xy01);
+			_mm_storeh_pi(reinterpret_cast<__m64*>(&vertex[1].u), uv01);
+			vertex[1].color = packedColor;
+			vertex[1].slot = _slots[i];
+			_mm_storel_pi(reinterpret_cast<__m64*>(&vertex[2].x), xy23);
+			_mm_storel_pi(reinterpret_cast<__m64*>(&vertex[2].u), uv23);
+			vertex[2].color = packedColor;
+			vertex[2].slot = _slots[i];
+			_mm_storeh_pi(reinterpret_cast<__m64*>(&vertex[3].x), xy23);
+			_mm_storeh_pi(reinterpret_cast<__m64*>(&vertex[3].u), uv23);
+			vertex[3].color = packedColor;
+			vertex[3].slot = _slots[i];
+		}
+#else
+		const float cornerX[4] = { -0.5f, 0.5f, 0.5f, -0.5f };
+		const float cornerY[4] = { -0.5f, -0.5f, 0.5f, 0.5f };
+
+		for (size_t i = 0; i < _numSprites; ++i)
+		{
+			const Sprite& sprite = *_sprites[i];
+			Vertex* vertex = _vertices + i * 4;
+
+			float cosine = 1.0f;
+			float sine = 0.0f;
+			if (sprite.rotation != 0.0f)
+			{
+				cosine = std::cos(sprite.rotation);
+				sine = std::sin(sprite.rotation);
+			}
+
+			uint32_t packedColor = 0;
+			for (int channel = 0; channel < 4; ++channel)
+			{
+				float value = std::min(std::max(sprite.color[channel], 0.0f), 1.0f);
+				packedColor |= static_cast<uint32_t>(std::nearbyint(value * 255.0f)) << (channel * 8);
+			}
+
+			for (int corner = 0; corner < 4; ++corner)
+			{
+				float offsetX = cornerX[corner] * sprite.size.x;
+				float offsetY = cornerY[corner] * sprite.size.y;
+				vertex[corner].x = sprite.position.x + offsetX * cosine - offsetY * sine;
+				vertex[corner].y = sprite.position.y + offsetX * sine + offsetY * cosine;
+				vertex[corner].u = (corner == 0 || corner == 3) ? sprite.uvRect.x : sprite.uvRect.z;
+				vertex[corner].v = (corner < 2) ? sprite.uvRect.y : sprite.uvRect.w;
+				vertex[corner].color = packedColor;
+				vertex[corner].slot = _slots[i];
+			}
+		}
+#endif
+	}
+
+} // namespace GLW
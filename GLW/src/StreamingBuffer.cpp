@@ -0,0 +1,202 @@
+#include "GLW/StreamingBuffer.h"
+
+namespace GLW
+{
+
+	namespace
+	{
+		// Keeps every write aligned for SIMD stores into the mapped memory
+		const GLsizeiptr WriteAlignment = 16;
+
+		GLsizeiptr AlignUp(GLsizeiptr _size)
+		{
+			return (_size + WriteAlignment - 1) / WriteAlignment * WriteAlignment;
+		}
+	}
+
+	StreamingBuffer::StreamingBuffer(GLsizeiptr _regionSize, unsigned int _numRegions) :
+		buffer(0), regionSize(AlignUp(_regionSize)), regionFences(_numRegions, nullptr), currentRegion(0), regionOffset(0),
+		persistentData(nullptr), mappedOffset(0), mappedSize(0), mapped(false), numStalls(0)
+	{
+		if (_regionSize <= 0 || _numRegions == 0)
+		{
+			std::cerr << "Streaming buffer needs a region size above zero and at least one region" << std::endl;
+			throw std::runtime_error("StreamingBuffer Error");
+		}
+
+		GLsizeiptr size = regionSize * _numRegions;
+		const GLbitfield persistentFlags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+
+		if (Capabilities::DirectStateAccess())
+		{
+			GL_CHECK(glCreateBuffers(1, &buffer));
+			GL_CHECK(glNamedBufferStorage(buffer, size, nullptr, persistentFlags));
+			persistentData = static_cast<unsigned char*>(glMapNamedBufferRange(buffer, 0, size, persistentFlags));
+		}
+		else
+		{
+			// The copy read target is not used for drawing so binding it disturbs nothing
+			GL_CHECK(glGenBuffers(1, &buffer));
+			GL_CHECK(glBindBuffer(GL_COPY_READ_BUFFER, buffer));
+			if (Capabilities::BufferStorage())
+			{
+				GL_CHECK(glBufferStorage(GL_COPY_READ_BUFFER, size, nullptr, persistentFlags));
+				persistentData = static_cast<unsigned char*>(glMapBufferRange(GL_COPY_READ_BUFFER, 0, size, persistentFlags));
+			}
+			else
+			{
+				GL_CHECK(glBufferData(GL_COPY_READ_BUFFER, size, nullptr, GL_STREAM_DRAW));
+			}
+			GL_CHECK(glBindBuffer(GL_COPY_READ_BUFFER, 0));
+		}
+
+		if (Capabilities::BufferStorage() && !persistentData)
+		{
+			glDeleteBuffers(1, &buffer);
+			std::cerr << "Could not persistently map the streaming buffer" << std::endl;
+			throw std::runtime_error("StreamingBuffer Error");
+		}
+	}
+
+	StreamingBuffer::~StreamingBuffer()
+	{
+		for (GLsync fence : regionFences)
+		{
+			if (fence)
+			{
+				glDeleteSync(fence);
+			}
+		}
+
+		// Deleting the buffer also unmaps it
+		glDeleteBuffers(1, &buffer);
+	}
+
+	void* StreamingBuffer::Map(GLsizeiptr _size)
+	{
+		if (_size <= 0 || _size > regionSize)
+		{
+			std::cerr << "Streaming buffer regions hold " << regionSize << " bytes, cannot write " << _size << std::endl;
+			throw std::runtime_error("StreamingBuffer Error");
+		}
+		if (mapped)
+		{
+			std::cerr << "Streaming buffer must be unmapped before it is mapped again" << std::endl;
+			throw std::runtime_error("StreamingBuffer Error");
+		}
+
+		if (regionOffset + _size > regionSize)
+		{
+			AdvanceRegion();
+		}
+
+		mappedOffset = currentRegion * regionSize + regionOffset;
+		mappedSize = _size;
+		regionOffset += AlignUp(_size);
+
+		if (persistentData)
+		{
+			mapped = true;
+			return persistentData + mappedOffset;
+		}
+
+		// The fences already keep the CPU off ranges the GPU may read, so the driver need not synchronise
+		GL_CHECK(glBindBuffer(GL_COPY_READ_BUFFER, buffer));
+		void* data = glMapBufferRange(GL_COPY_READ_BUFFER, mappedOffset, mappedSize,
+			GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+		GL_CHECK(glBindBuffer(GL_COPY_READ_BUFFER, 0));
+
+		if (!data)
+		{
+			CheckOpenGLError("glMapBufferRange", __FILE__, __LINE__);
+			std::cerr << "Could not map the streaming buffer" << std::endl;
+			throw std::runtime_error("StreamingBuffer Error");
+		}
+		mapped = true;
+		return data;
+	}
+
+	void StreamingBuffer::Unmap()
+	{
+		if (!mapped)
+		{
+			std::cerr << "Streaming buffer must be mapped before it is unmapped" << std::endl;
+			throw std::runtime_error("StreamingBuffer Error");
+		}
+		mapped = false;
+
+		if (!persistentData)
+		{
+			GL_CHECK(glBindBuffer(GL_COPY_READ_BUFFER, buffer));
+			GL_CHECK(glUnmapBuffer(GL_COPY_READ_BUFFER));
+			GL_CHECK(glBindBuffer(GL_COPY_READ_BUFFER, 0));
+		}
+	}
+
+	void StreamingBuffer::Copy(GLuint _buffer, GLintptr _offset)
+	{
+		Unmap();
+
+		if (Capabilities::DirectStateAccess())
+		{
+			GL_CHECK(glCopyNamedBufferSubData(buffer, _buffer, mappedOffset, _offset, mappedSize));
+		}
+		else
+		{
+			GL_CHECK(glBindBuffer(GL_COPY_READ_BUFFER, buffer));
+			GL_CHECK(glBindBuffer(GL_COPY_WRITE_BUFFER, _buffer));
+			GL_CHECK(glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, mappedOffset, _offset, mappedSize));
+			GL_CHECK(glBindBuffer(GL_COPY_WRITE_BUFFER, 0));
+			GL_CHECK(glBindBuffer(GL_COPY_READ_BUFFER, 0));
+		}
+	}
+
+	void StreamingBuffer::NextRegion()
+	{
+		if (mapped)
+		{
+			std::cerr << "Streaming buffer must be unmapped before moving to the next region" << std::endl;
+			throw std::runtime_error("StreamingBuffer Error");
+		}
+
+		if (regionOffset > 0)
+		{
+			AdvanceRegion();
+		}
+	}
+
+	void StreamingBuffer::AdvanceRegion()
+	{
+		// The GPU is done with the region once every draw and copy issued so far has completed
+		GLsync& fence = regionFences[currentRegion];
+		if (fence)
+		{
+			glDeleteSync(fence);
+		}
+		fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+
+		currentRegion = (currentRegion + 1) % regionFences.size();
+		regionOffset = 0;
+
+		GLsync& nextFence = regionFences[currentRegion];
+		if (nextFence)
+		{
+			// Flushing makes sure the fence actually reaches the GPU, otherwise waiting on it could never return
+			GLenum result = glClientWaitSync(nextFence, GL_SYNC_FLUSH_COMMANDS_BIT, 0);
+			if (result == GL_TIMEOUT_EXPIRED)
+			{
+				++numStalls;
+				result = glClientWaitSync(nextFence, GL_SYNC_FLUSH_COMMANDS_BIT, GL_TIMEOUT_IGNORED);
+			}
+			if (result == GL_WAIT_FAILED)
+			{
+				CheckOpenGLError("glClientWaitSync", __FILE__, __LINE__);
+				throw std::runtime_error("StreamingBuffer Error");
+			}
+
+			glDeleteSync(nextFence);
+			nextFence = nullptr;
+		}
+	}
+
+} // namespace GLW
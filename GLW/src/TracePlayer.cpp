@@ -0,0 +1,387 @@
+#include "GLW/TracePlayer.h"
+
+#include <cstring>
+
+namespace GLW
+{
+
+	using TraceCommand = TraceFormat::Command;
+
+	TracePlayer::TracePlayer(const std::string& _tracePath) :
+		file(MappedFile::Make(_tracePath)), cursor(nullptr), end(nullptr), numFrames(0), numCommands(0)
+	{
+		cursor = file->GetData();
+		end = cursor + file->GetSize();
+
+		TraceFormat::Header header = Read<TraceFormat::Header>();
+		if (header.magic != TraceFormat::Magic)
+		{
+			std::cerr << "Not a GLW trace file: " << _tracePath << std::endl;
+			throw std::runtime_error("TracePlayer Error");
+		}
+		if (header.version != TraceFormat::Version)
+		{
+			std::cerr << "Trace file " << _tracePath << " is version " << header.version
+				<< ", this build reads version " << TraceFormat::Version << std::endl;
+			throw std::runtime_error("TracePlayer Error");
+		}
+	}
+
+	TracePlayer::~TracePlayer()
+	{
+
+	}
+
+	bool TracePlayer::ReplayFrame()
+	{
+		if (cursor == end)
+		{
+			return false;
+		}
+
+		// A trace which was not stopped cleanly may end part way through a frame
+		while (cursor != end)
+		{
+			TraceCommand command = static_cast<TraceCommand>(Read<uint8_t>());
+			if (command >= TraceCommand::NumCommands)
+			{
+				std::cerr << "Unknown trace command " << static_cast<int>(command) << " at offset "
+					<< (cursor - 1 - file->GetData()) << " in " << file->GetPath() << std::endl;
+				throw std::runtime_error("TracePlayer Error");
+			}
+
+			++numCommands;
+			if (command == TraceCommand::EndFrame)
+			{
+				break;
+			}
+			ReplayCommand(command);
+		}
+
+		++numFrames;
+		return true;
+	}
+
+	void TracePlayer::ReplayCommand(TraceFormat::Command _command)
+	{
+		switch (_command)
+		{
+		case TraceCommand::SetClearColor:
+		{
+			float red = Read<float>();
+			float green = Read<float>();
+			float blue = Read<float>();
+			float alpha = Read<float>();
+			SetClearColor(red, green, blue, alpha);
+			break;
+		}
+		case TraceCommand::ClearFramebuffer:
+			ClearFramebuffer();
+			break;
+		case TraceCommand::SetViewport:
+		{
+			int32_t x = Read<int32_t>();
+			int32_t y = Read<int32_t>();
+			int32_t width = Read<int32_t>();
+			int32_t height = Read<int32_t>();
+			SetViewport(x, y, width, height);
+			break;
+		}
+		case TraceCommand::CreateFramebuffer:
+		{
+			std::string key = ReadString();
+			int32_t width = Read<int32_t>();
+			int32_t height = Read<int32_t>();
+			std::vector<GLenum> colorFormats(Read<uint32_t>());
+			for (auto& colorFormat : colorFormats)
+			{
+				colorFormat = Read<uint32_t>();
+			}
+			GLenum depthFormat = Read<uint32_t>();
+			CreateFramebuffer(key, width, height, colorFormats, depthFormat);
+			break;
+		}
+		case TraceCommand::BindFramebuffer:
+			BindFramebuffer(ReadString());
+			break;
+		case TraceCommand::BindDefaultFramebuffer:
+		{
+			int32_t width = Read<int32_t>();
+			int32_t height = Read<int32_t>();
+			BindDefaultFramebuffer(width, height);
+			break;
+		}
+		case TraceCommand::SetActiveFramebufferTexture:
+		{
+			std::string key = ReadString();
+			SetActiveFramebufferTexture(key, Read<uint32_t>());
+			break;
+		}
+		case TraceCommand::CreateTexture:
+		{
+			std::string key = ReadString();
+			int32_t width = Read<int32_t>();
+			int32_t height = Read<int32_t>();
+			int32_t channels = Read<int32_t>();
+			bool sRGB = Read<uint8_t>() != 0;
+			uint64_t size;
+			const unsigned char* pixels = ReadBlob(size);
+			if (size != static_cast<uint64_t>(width) * height * channels)
+			{
+				std::cerr << "Trace texture " << key << " has " << size << " bytes of pixels for a "
+					<< width << "x" << height << "x" << channels << " image" << std::endl;
+				throw std::runtime_error("TracePlayer Error");
+			}
+			CreateTexture(key, width, height, channels, pixels, sRGB);
+			break;
+		}
+		case TraceCommand::SetActiveTexture:
+			SetActiveTexture(ReadString());
+			break;
+		case TraceCommand::SetTextureUnit:
+			SetTextureUnit(Read<int32_t>());
+			break;
+		case TraceCommand::CreateVertexArray:
+		case TraceCommand::CreateHeapVertexArray:
+		{
+			std::string key = ReadString();
+			uint64_t vertexBytes, indexBytes;
+			const unsigned char* vertices = ReadBlob(vertexBytes);
+			const unsigned char* indices = ReadBlob(indexBytes);
+			AttributeLayout attributeLayout = ReadLayout();
+
+			// Blobs are not aligned within the trace, so copy before handing them on as floats and ints
+			std::vector<float> vertexData(static_cast<size_t>(vertexBytes / sizeof(float)));
+			std::vector<unsigned int> indexData(static_cast<size_t>(indexBytes / sizeof(unsigned int)));
+			std::memcpy(vertexData.data(), vertices, vertexData.size() * sizeof(float));
+			std::memcpy(indexData.data(), indices, indexData.size() * sizeof(unsigned int));
+
+			if (_command == TraceCommand::CreateHeapVertexArray)
+			{
+				CreateVertexArray(key, vertexData, indexData, attributeLayout, ReadString());
+			}
+			else
+			{
+				CreateVertexArray(key, vertexData, indexData, attributeLayout);
+			}
+			break;
+		}
+		case TraceCommand::BindVertexArray:
+			BindVertexArray(ReadString());
+			break;
+		case TraceCommand::RenderVertexArray:
+			RenderVertexArray(ReadString());
+			break;
+		case TraceCommand::CreateBufferHeap:
+		{
+			std::string key = ReadString();
+			CreateBufferHeap(key, Read<uint64_t>());
+			break;
+		}
+		case TraceCommand::DefragmentBufferHeap:
+			DefragmentBufferHeap(ReadString());
+			break;
+		case TraceCommand::CreateUniformBuffer:
+		{
+			std::string name = ReadString();
+			uint32_t size = Read<uint32_t>();
+			std::vector<std::string> shaderKeys(Read<uint32_t>());
+			for (auto& shaderKey : shaderKeys)
+			{
+				shaderKey = ReadString();
+			}
+			CreateUniformBuffer(name, size, shaderKeys);
+			break;
+		}
+		case TraceCommand::SetUniformBuffer:
+		{
+			std::string name = ReadString();
+			uint32_t offset = Read<uint32_t>();
+			SetUniformBuffer(name, offset, ReadMat4());
+			break;
+		}
+		case TraceCommand::SetUniformBufferData:
+		{
+			std::string name = ReadString();
+			uint32_t offset = Read<uint32_t>();
+			uint64_t size;
+			const unsigned char* data = ReadBlob(size);
+			SetUniformBuffer(name, offset, static_cast<unsigned int>(size), data);
+			break;
+		}
+		case TraceCommand::CreateStorageBuffer:
+		{
+			std::string key = ReadString();
+			uint32_t size = Read<uint32_t>();
+			uint64_t dataSize;
+			const unsigned char* data = ReadBlob(dataSize);
+			CreateStorageBuffer(key, size, dataSize > 0 ? data : nullptr);
+			break;
+		}
+		case TraceCommand::SetStorageBuffer:
+		{
+			std::string key = ReadString();
+			uint32_t offset = Read<uint32_t>();
+			uint64_t size;
+			const unsigned char* data = ReadBlob(size);
+			SetStorageBuffer(key, offset, static_cast<unsigned int>(size), data);
+			break;
+		}
+		case TraceCommand::BindStorageBuffer:
+		{
+			std::string key = ReadString();
+			BindStorageBuffer(key, Read<uint32_t>());
+			break;
+		}
+		case TraceCommand::CreateShader:
+		{
+			std::string key = ReadString();
+			std::string vertexSource = ReadText();
+			std::string fragmentSource = ReadText();
+			CreateShaderFromSource(key, vertexSource, fragmentSource);
+			break;
+		}
+		case TraceCommand::CreateComputeShader:
+		{
+			std::string key = ReadString();
+			CreateComputeShaderFromSource(key, ReadText());
+			break;
+		}
+		case TraceCommand::UseShader:
+			UseShader(ReadString());
+			break;
+		case TraceCommand::SpecifyAttributeLayout:
+		{
+			std::string shaderKey = ReadString();
+			SpecifyAttributeLayout(shaderKey, ReadString());
+			break;
+		}
+		case TraceCommand::SetUniformInt:
+		case TraceCommand::SetUniformFloat:
+		case TraceCommand::SetUniformVec3:
+		case TraceCommand::SetUniformVec4:
+		case TraceCommand::SetUniformMat4:
+		{
+			std::string shaderKey = ReadString();
+			std::string uniformKey = ReadString();
+			switch (_command)
+			{
+			case TraceCommand::SetUniformInt: SetUniform(shaderKey, uniformKey, static_cast<int>(Read<int32_t>())); break;
+			case TraceCommand::SetUniformFloat: SetUniform(shaderKey, uniformKey, Read<float>()); break;
+			case TraceCommand::SetUniformVec3: SetUniform(shaderKey, uniformKey, ReadVec3()); break;
+			case TraceCommand::SetUniformVec4: SetUniform(shaderKey, uniformKey, ReadVec4()); break;
+			default: SetUniform(shaderKey, uniformKey, ReadMat4()); break;
+			}
+			break;
+		}
+		case TraceCommand::DispatchCompute:
+		{
+			std::string key = ReadString();
+			uint32_t x = Read<uint32_t>();
+			uint32_t y = Read<uint32_t>();
+			uint32_t z = Read<uint32_t>();
+			DispatchCompute(key, x, y, z);
+			break;
+		}
+		case TraceCommand::InsertMemoryBarrier:
+			InsertMemoryBarrier(Read<uint32_t>());
+			break;
+		default:
+			break;
+		}
+	}
+
+	template <typename T>
+	T TracePlayer::Read()
+	{
+		T value;
+		ReadBytes(&value, sizeof(T));
+		return value;
+	}
+
+	void TracePlayer::ReadBytes(void* _data, size_t _size)
+	{
+		std::memcpy(_data, Take(_size), _size);
+	}
+
+	const std::string& TracePlayer::ReadString()
+	{
+		uint32_t id = Read<uint32_t>();
+		if (id & TraceFormat::NewStringBit)
+		{
+			id &= ~TraceFormat::NewStringBit;
+			if (id != strings.size())
+			{
+				std::cerr << "Trace string " << id << " is out of order in " << file->GetPath() << std::endl;
+				throw std::runtime_error("TracePlayer Error");
+			}
+			strings.push_back(ReadText());
+		}
+		else if (id >= strings.size())
+		{
+			std::cerr << "Trace string " << id << " is used before it is defined in " << file->GetPath() << std::endl;
+			throw std::runtime_error("TracePlayer Error");
+		}
+
+		return strings[id];
+	}
+
+	std::string TracePlayer::ReadText()
+	{
+		uint32_t length = Read<uint32_t>();
+		const char* characters = reinterpret_cast<const char*>(Take(length));
+		return std::string(characters, length);
+	}
+
+	const unsigned char* TracePlayer::ReadBlob(uint64_t& _size)
+	{
+		_size = Read<uint64_t>();
+		return Take(_size);
+	}
+
+	AttributeLayout TracePlayer::ReadLayout()
+	{
+		AttributeLayout attributeLayout(Read<uint32_t>());
+		for (auto& attributeAndNumValues : attributeLayout)
+		{
+			std::string name = ReadString();
+			attributeAndNumValues = std::make_tuple(name, static_cast<int>(Read<int32_t>()));
+		}
+		return attributeLayout;
+	}
+
+	glm::vec3 TracePlayer::ReadVec3()
+	{
+		glm::vec3 value;
+		ReadBytes(glm::value_ptr(value), sizeof(float) * 3);
+		return value;
+	}
+
+	glm::vec4 TracePlayer::ReadVec4()
+	{
+		glm::vec4 value;
+		ReadBytes(glm::value_ptr(value), sizeof(float) * 4);
+		return value;
+	}
+
+	glm::mat4 TracePlayer::ReadMat4()
+	{
+		glm::mat4 value;
+		ReadBytes(glm::value_ptr(value), sizeof(float) * 16);
+		return value;
+	}
+
+	const unsigned char* TracePlayer::Take(uint64_t _size)
+	{
+		if (_size > static_cast<uint64_t>(end - cursor))
+		{
+			std::cerr << "Trace file ends part way through a record: " << file->GetPath() << std::endl;
+			throw std::runtime_error("TracePlayer Error");
+		}
+
+		const unsigned char* data = cursor;
+		cursor += _size;
+		return data;
+	}
+
+} // namespace GLW
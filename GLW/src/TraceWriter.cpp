@@ -0,0 +1,181 @@
+#include "GLW/TraceWriter.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+
+namespace GLW
+{
+
+	TraceWriter::TraceWriter(const std::string& _path, size_t _bufferSize) :
+		path(_path), ringMask(0), head(0), tail(0), cachedTail(0), flushed(0), numStalls(0),
+		stopping(false), failed(false)
+	{
+		file.open(_path, std::ios::binary | std::ios::trunc);
+		if (!file)
+		{
+			std::cerr << "Could not open trace file: " << _path << std::endl;
+			throw std::runtime_error("TraceWriter Error");
+		}
+
+		// A power of two size lets positions wrap with a mask
+		size_t ringSize = 4096;
+		while (ringSize < _bufferSize)
+		{
+			ringSize <<= 1;
+		}
+		ring.resize(ringSize);
+		ringMask = ringSize - 1;
+
+		TraceFormat::Header header = { TraceFormat::Magic, TraceFormat::Version };
+		WriteBytes(&header, sizeof(header));
+
+		writer = std::thread(&TraceWriter::Run, this);
+	}
+
+	TraceWriter::~TraceWriter()
+	{
+		stopping.store(true, std::memory_order_release);
+		writer.join();
+	}
+
+	void TraceWriter::WriteCommand(TraceFormat::Command _command)
+	{
+		WriteValue(static_cast<uint8_t>(_command));
+	}
+
+	void TraceWriter::WriteString(const std::string& _string)
+	{
+		auto id = stringIds.find(_string);
+		if (id != stringIds.end())
+		{
+			WriteValue(id->second);
+			return;
+		}
+
+		uint32_t newId = static_cast<uint32_t>(stringIds.size());
+		stringIds.insert(std::make_pair(_string, newId));
+		WriteValue(newId | TraceFormat::NewStringBit);
+		WriteText(_string);
+	}
+
+	void TraceWriter::WriteText(const std::string& _text)
+	{
+		WriteValue(static_cast<uint32_t>(_text.size()));
+		WriteBytes(_text.data(), _text.size());
+	}
+
+	void TraceWriter::WriteBlob(const void* _data, uint64_t _size)
+	{
+		WriteValue(_size);
+		WriteBytes(_data, static_cast<size_t>(_size));
+	}
+
+	void TraceWriter::WriteLayout(const AttributeLayout& _attributeLayout)
+	{
+		WriteValue(static_cast<uint32_t>(_attributeLayout.size()));
+		for (const auto& attributeAndNumValues : _attributeLayout)
+		{
+			WriteString(std::get<std::string>(attributeAndNumValues));
+			WriteValue(static_cast<int32_t>(std::get<int>(attributeAndNumValues)));
+		}
+	}
+
+	void TraceWriter::WriteBytes(const void* _data, size_t _size)
+	{
+		const unsigned char* bytes = static_cast<const unsigned char*>(_data);
+		uint64_t position = head.load(std::memory_order_relaxed);
+
+		// Large blobs are copied in pieces as the writer thread frees up space
+		bool stalled = false;
+		while (_size > 0)
+		{
+			// Only look at the consumer's position when the last one seen leaves too little room
+			size_t space = ring.size() - static_cast<size_t>(position - cachedTail);
+			if (space < _size)
+			{
+				cachedTail = tail.load(std::memory_order_acquire);
+				space = ring.size() - static_cast<size_t>(position - cachedTail);
+			}
+
+			if (space == 0)
+			{
+				if (!stalled)
+				{
+					++numStalls;
+					stalled = true;
+				}
+				std::this_thread::yield();
+				continue;
+			}
+
+			size_t count = std::min(space, _size);
+			size_t start = static_cast<size_t>(position) & ringMask;
+			size_t firstPart = std::min(count, ring.size() - start);
+			std::memcpy(&ring[start], bytes, firstPart);
+			std::memcpy(&ring[0], bytes + firstPart, count - firstPart);
+
+			position += count;
+			bytes += count;
+			_size -= count;
+
+			head.store(position, std::memory_order_release);
+		}
+	}
+
+	void TraceWriter::Flush()
+	{
+		const uint64_t target = head.load(std::memory_order_relaxed);
+		while (flushed.load(std::memory_order_acquire) < target)
+		{
+			std::this_thread::yield();
+		}
+	}
+
+	void TraceWriter::Run()
+	{
+		uint64_t position = tail.load(std::memory_order_relaxed);
+		for (;;)
+		{
+			// Check for stopping first so the last records written before it are not missed
+			bool stop = stopping.load(std::memory_order_acquire);
+			uint64_t available = head.load(std::memory_order_acquire) - position;
+
+			if (available == 0)
+			{
+				if (stop)
+				{
+					break;
+				}
+
+				// Caught up, so push what has been written out of the stream's buffer
+				if (flushed.load(std::memory_order_relaxed) != position)
+				{
+					file.flush();
+					flushed.store(position, std::memory_order_release);
+				}
+				std::this_thread::sleep_for(std::chrono::milliseconds(1));
+				continue;
+			}
+
+			size_t start = static_cast<size_t>(position) & ringMask;
+			size_t count = std::min(static_cast<size_t>(available), ring.size() - start);
+
+			if (!failed.load(std::memory_order_relaxed))
+			{
+				file.write(reinterpret_cast<const char*>(&ring[start]), count);
+				if (!file)
+				{
+					std::cerr << "Could not write to trace file, the rest of the trace is discarded: " << path << std::endl;
+					failed.store(true, std::memory_order_relaxed);
+				}
+			}
+
+			position += count;
+			tail.store(position, std::memory_order_release);
+		}
+
+		file.close();
+	}
+
+} // namespace GLW
@@ -0,0 +1,447 @@
+#include "GLW/TransformHierarchy.h"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include <type_traits>
+
+#if defined(__AVX2__) && (defined(__FMA__) || defined(_MSC_VER))
+	#define GLW_TRANSFORM_AVX2
+	#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+	#define GLW_TRANSFORM_SSE
+	#include <xmmintrin.h>
+#endif
+
+namespace GLW
+{
+
+	namespace
+	{
+		// Transforms per chunk handed to a worker, small enough to balance and large
+		// enough that waking the workers costs less than the work
+		const size_t UpdateGrain = 4096;
+		const size_t WriteGrain = 8192;
+
+		// _out = _a * _b for column major 4x4 matrices, _out must not alias either input
+		inline void Multiply(const float* _a, const float* _b, float* _out)
+		{
+#if defined(GLW_TRANSFORM_AVX2)
+			// Two result columns at once, each a sum of _a's columns weighted by one column of _b
+			__m256 a0 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(_a));
+			__m256 a1 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(_a + 4));
+			__m256 a2 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(_a + 8));
+			__m256 a3 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(_a + 12));
+			for (int column = 0; column < 16; column += 8)
+			{
+				__m256 b = _mm256_loadu_ps(_b + column);
+				__m256 result = _mm256_mul_ps(a0, _mm256_permute_ps(b, 0x00));
+				result = _mm256_fmadd_ps(a1, _mm256_permute_ps(b, 0x55), result);
+				result = _mm256_fmadd_ps(a2, _mm256_permute_ps(b, 0xAA), result);
+				result = _mm256_fmadd_ps(a3, _mm256_permute_ps(b, 0xFF), result);
+				_mm256_storeu_ps(_out + column, result);
+			}
+#elif defined(GLW_TRANSFORM_SSE)
+			__m128 a0 = _mm_loadu_ps(_a);
+			__m128 a1 = _mm_loadu_ps(_a + 4);
+			__m128 a2 = _mm_loadu_ps(_a + 8);
+			__m128 a3 = _mm_loadu_ps(_a + 12);
+			for (int column = 0; column < 16; column += 4)
+			{
+				__m128 result = _mm_mul_ps(a0, _mm_set1_ps(_b[column]));
+				result = _mm_add_ps(result, _mm_mul_ps(a1, _mm_set1_ps(_b[column + 1])));
+				result = _mm_add_ps(result, _mm_mul_ps(a2, _mm_set1_ps(_b[column + 2])));
+				result = _mm_add_ps(result, _mm_mul_ps(a3, _mm_set1_ps(_b[column + 3])));
+				_mm_storeu_ps(_out + column, result);
+			}
+#else
+			for (int column = 0; column < 16; column += 4)
+			{
+				for (int row = 0; row < 4; ++row)
+				{
+					_out[column + row] = _a[row] * _b[column] + _a[4 + row] * _b[column + 1]
+						+ _a[8 + row] * _b[column + 2] + _a[12 + row] * _b[column + 3];
+				}
+			}
+#endif
+		}
+
+		// translate * rotate * scale as a column major matrix, the rotation is assumed to be normalised
+		inline void ComposeLocal(const glm::vec3& _translation, const glm::quat& _rotation, const glm::vec3& _scale, float* _out)
+		{
+			const float x = _rotation.x, y = _rotation.y, z = _rotation.z, w = _rotation.w;
+			const float xx = x * x, yy = y * y, zz = z * z;
+			const float xy = x * y, xz = x * z, yz = y * z;
+			const float wx = w * x, wy = w * y, wz = w * z;
+
+			_out[0] = (1.0f - 2.0f * (yy + zz)) * _scale.x;
+			_out[1] = 2.0f * (xy + wz) * _scale.x;
+			_out[2] = 2.0f * (xz - wy) * _scale.x;
+			_out[3] = 0.0f;
+
+			_out[4] = 2.0f * (xy - wz) * _scale.y;
+			_out[5] = (1.0f - 2.0f * (xx + zz)) * _scale.y;
+			_out[6] = 2.0f * (yz + wx) * _scale.y;
+			_out[7] = 0.0f;
+
+			_out[8] = 2.0f * (xz + wy) * _scale.z;
+			_out[9] = 2.0f * (yz - wx) * _scale.z;
+			_out[10] = (1.0f - 2.0f * (xx + yy)) * _scale.z;
+			_out[11] = 0.0f;
+
+			_out[12] = _translation.x;
+			_out[13] = _translation.y;
+			_out[14] = _translation.z;
+			_out[15] = 1.0f;
+		}
+	}
+
+	TransformHierarchy::TransformHierarchy(unsigned int _numThreads) :
+		levelStarts(1, 0), unsorted(false), anyDirty(false), numUpdated(0),
+		job(nullptr), jobCount(0), jobGrain(1), numChunks(0), nextChunk(0),
+		jobGeneration(0), numBusyWorkers(0), stopping(false)
+	{
+		unsigned int numThreads = (_numThreads == 0) ? std::thread::hardware_concurrency() : _numThreads;
+		for (unsigned int i = 1; i < numThreads; ++i)
+		{
+			workers.push_back(std::thread(&TransformHierarchy::RunWorker, this));
+		}
+	}
+
+	TransformHierarchy::~TransformHierarchy()
+	{
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			stopping = true;
+		}
+		jobAdded.notify_all();
+		for (auto& worker : workers)
+		{
+			worker.join();
+		}
+	}
+
+	TransformHierarchy::Handle TransformHierarchy::Add(Handle _parent, const glm::vec3& _translation,
+		const glm::quat& _rotation, const glm::vec3& _scale)
+	{
+		uint32_t parentSlot = NoParent;
+		uint32_t depth = 0;
+		if (_parent != NoParent)
+		{
+			parentSlot = GetSlot(_parent);
+			depth = depths[parentSlot] + 1;
+		}
+
+		const Handle handle = static_cast<Handle>(slots.size());
+		const uint32_t slot = static_cast<uint32_t>(translations.size());
+
+		translations.push_back(_translation);
+		rotations.push_back(_rotation);
+		scales.push_back(_scale);
+		parents.push_back(parentSlot);
+		depths.push_back(depth);
+		dirty.push_back(1);
+		worldMatrices.push_back(glm::mat4(1.0f));
+		handles.push_back(handle);
+		slots.push_back(slot);
+		anyDirty = true;
+
+		// Appending keeps depth order as long as the new transform is no shallower than the last
+		if (!unsorted)
+		{
+			const uint32_t numLevels = static_cast<uint32_t>(levelStarts.size() - 1);
+			if (depth + 1 == numLevels)
+			{
+				++levelStarts.back();
+			}
+			else if (depth == numLevels)
+			{
+				levelStarts.push_back(levelStarts.back() + 1);
+			}
+			else
+			{
+				unsorted = true;
+			}
+		}
+
+		return handle;
+	}
+
+	void TransformHierarchy::SetTranslation(Handle _handle, const glm::vec3& _translation)
+	{
+		uint32_t slot = GetSlot(_handle);
+		translations[slot] = _translation;
+		MarkDirty(slot);
+	}
+
+	void TransformHierarchy::SetRotation(Handle _handle, const glm::quat& _rotation)
+	{
+		uint32_t slot = GetSlot(_handle);
+		rotations[slot] = _rotation;
+		MarkDirty(slot);
+	}
+
+	void TransformHierarchy::SetScale(Handle _handle, const glm::vec3& _scale)
+	{
+		uint32_t slot = GetSlot(_handle);
+		scales[slot] = _scale;
+		MarkDirty(slot);
+	}
+
+	void TransformHierarchy::SetLocal(Handle _handle, const glm::vec3& _translation, const glm::quat& _rotation, const glm::vec3& _scale)
+	{
+		uint32_t slot = GetSlot(_handle);
+		translations[slot] = _translation;
+		rotations[slot] = _rotation;
+		scales[slot] = _scale;
+		MarkDirty(slot);
+	}
+
+	TransformHierarchy::Handle TransformHierarchy::GetParent(Handle _handle) const
+	{
+		uint32_t parentSlot = parents[GetSlot(_handle)];
+		return (parentSlot == NoParent) ? NoParent : handles[parentSlot];
+	}
+
+	void TransformHierarchy::Update()
+	{
+		if (unsorted)
+		{
+			Sort();
+		}
+
+		if (!anyDirty)
+		{
+			numUpdated = 0;
+			return;
+		}
+
+		// Levels run in order so every parent is final before its children read it
+		std::atomic<size_t> totalUpdated(0);
+		for (size_t level = 0; level + 1 < levelStarts.size(); ++level)
+		{
+			const uint32_t levelStart = levelStarts[level];
+			ParallelFor(levelStarts[level + 1] - levelStart, UpdateGrain, [&](size_t _begin, size_t _end)
+			{
+				totalUpdated += UpdateRange(levelStart + static_cast<uint32_t>(_begin), levelStart + static_cast<uint32_t>(_end));
+			});
+		}
+
+		std::fill(dirty.begin(), dirty.end(), 0);
+		anyDirty = false;
+		numUpdated = totalUpdated;
+	}
+
+	void TransformHierarchy::WriteMatrices(void* _destination, size_t _stride, const glm::mat4& _viewProjection)
+	{
+		unsigned char* destination = static_cast<unsigned char*>(_destination);
+		ParallelFor(slots.size(), WriteGrain, [&](size_t _begin, size_t _end)
+		{
+			WriteRange(destination, _stride, &_viewProjection, _begin, _end);
+		});
+	}
+
+	void TransformHierarchy::WriteWorldMatrices(void* _destination, size_t _stride)
+	{
+		unsigned char* destination = static_cast<unsigned char*>(_destination);
+		ParallelFor(slots.size(), WriteGrain, [&](size_t _begin, size_t _end)
+		{
+			WriteRange(destination, _stride, nullptr, _begin, _end);
+		});
+	}
+
+	uint32_t TransformHierarchy::GetSlot(Handle _handle) const
+	{
+		if (_handle >= slots.size())
+		{
+			std::cerr << "Transform handle " << _handle << " out of range, " << slots.size() << " transforms added" << std::endl;
+			throw std::runtime_error("TransformHierarchy Error");
+		}
+		return slots[_handle];
+	}
+
+	void TransformHierarchy::MarkDirty(uint32_t _slot)
+	{
+		// Descendants are marked as Update reaches them, so only the transform itself is flagged here
+		dirty[_slot] = 1;
+		anyDirty = true;
+	}
+
+	void TransformHierarchy::Sort()
+	{
+		const uint32_t numTransforms = static_cast<uint32_t>(translations.size());
+		const uint32_t numLevels = *std::max_element(depths.begin(), depths.end()) + 1;
+
+		// Count each level then turn the counts into starting slots
+		levelStarts.assign(numLevels + 1, 0);
+		for (uint32_t depth : depths)
+		{
+			++levelStarts[depth + 1];
+		}
+		for (uint32_t level = 0; level < numLevels; ++level)
+		{
+			levelStarts[level + 1] += levelStarts[level];
+		}
+
+		// Stable, so transforms keep their relative order within a level
+		std::vector<uint32_t> newSlots(numTransforms);
+		std::vector<uint32_t> nextSlot(levelStarts.begin(), levelStarts.end() - 1);
+		for (uint32_t slot = 0; slot < numTransforms; ++slot)
+		{
+			newSlots[slot] = nextSlot[depths[slot]]++;
+		}
+
+		auto permute = [&](auto& _values)
+		{
+			typename std::decay<decltype(_values)>::type sorted(_values.size());
+			for (uint32_t slot = 0; slot < numTransforms; ++slot)
+			{
+				sorted[newSlots[slot]] = _values[slot];
+			}
+			_values.swap(sorted);
+		};
+
+		for (auto& parent : parents)
+		{
+			parent = (parent == NoParent) ? NoParent : newSlots[parent];
+		}
+
+		permute(translations);
+		permute(rotations);
+		permute(scales);
+		permute(parents);
+		permute(depths);
+		permute(dirty);
+		permute(worldMatrices);
+		permute(handles);
+
+		for (uint32_t slot = 0; slot < numTransforms; ++slot)
+		{
+			slots[handles[slot]] = slot;
+		}
+
+		unsorted = false;
+	}
+
+	size_t TransformHierarchy::UpdateRange(uint32_t _begin, uint32_t _end)
+	{
+		size_t numChanged = 0;
+		float local[16];
+
+		for (uint32_t slot = _begin; slot < _end; ++slot)
+		{
+			// Parents are on an earlier level, so their flag already says whether they were recomputed
+			const uint32_t parent = parents[slot];
+			if (!dirty[slot] && (parent == NoParent || !dirty[parent]))
+			{
+				continue;
+			}
+			dirty[slot] = 1;
+
+			float* world = &worldMatrices[slot][0][0];
+			if (parent == NoParent)
+			{
+				ComposeLocal(translations[slot], rotations[slot], scales[slot], world);
+			}
+			else
+			{
+				ComposeLocal(translations[slot], rotations[slot], scales[slot], local);
+				Multiply(&worldMatrices[parent][0][0], local, world);
+			}
+			++numChanged;
+		}
+
+		return numChanged;
+	}
+
+	void TransformHierarchy::WriteRange(unsigned char* _destination, size_t _stride, const glm::mat4* _viewProjection,
+		size_t _begin, size_t _end) const
+	{
+		// Handle order keeps the writes sequential, which matters far more for mapped memory than the reads
+		for (size_t handle = _begin; handle < _end; ++handle)
+		{
+			float* destination = reinterpret_cast<float*>(_destination + handle * _stride);
+			const float* world = &worldMatrices[slots[handle]][0][0];
+			if (_viewProjection)
+			{
+				Multiply(&(*_viewProjection)[0][0], world, destination);
+			}
+			else
+			{
+				std::memcpy(destination, world, sizeof(glm::mat4));
+			}
+		}
+	}
+
+	void TransformHierarchy::ParallelFor(size_t _count, size_t _grain, const std::function<void(size_t, size_t)>& _job)
+	{
+		if (workers.empty() || _count <= _grain)
+		{
+			if (_count > 0)
+			{
+				_job(0, _count);
+			}
+			return;
+		}
+
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			job = &_job;
+			jobCount = _count;
+			jobGrain = _grain;
+			numChunks = (_count + _grain - 1) / _grain;
+			nextChunk = 0;
+			numBusyWorkers = static_cast<unsigned int>(workers.size());
+			++jobGeneration;
+		}
+		jobAdded.notify_all();
+
+		// The calling thread takes chunks too rather than waiting idle
+		RunChunks();
+
+		std::unique_lock<std::mutex> lock(mutex);
+		jobFinished.wait(lock, [this]() { return numBusyWorkers == 0; });
+		job = nullptr;
+	}
+
+	void TransformHierarchy::RunChunks()
+	{
+		for (;;)
+		{
+			size_t chunk = nextChunk++;
+			if (chunk >= numChunks)
+			{
+				return;
+			}
+
+			size_t begin = chunk * jobGrain;
+			(*job)(begin, std::min(jobCount, begin + jobGrain));
+		}
+	}
+
+	void TransformHierarchy::RunWorker()
+	{
+		unsigned long long lastGeneration = 0;
+		for (;;)
+		{
+			{
+				std::unique_lock<std::mutex> lock(mutex);
+				jobAdded.wait(lock, [&]() { return stopping || jobGeneration != lastGeneration; });
+				if (stopping)
+				{
+					return;
+				}
+				lastGeneration = jobGeneration;
+			}
+
+			RunChunks();
+
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				--numBusyWorkers;
+			}
+			jobFinished.notify_one();
+		}
+	}
+
+} // namespace GLW
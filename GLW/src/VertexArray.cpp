@@ -6,45 +6,187 @@ namespace GLW
     VertexArray::VertexArray(const std::vector<float>& _vertices,
         const std::vector<unsigned int>& _elements,
         const AttributeLayout& _attributeLayout) :
-        vao(0), vbo(0), attributeLayout(_attributeLayout)
+        VertexArray(_vertices.data(), _vertices.size(), _elements.data(), _elements.size(), _attributeLayout)
+    {
+
+    }
+
+    VertexArray::VertexArray(const float* _vertices, size_t _numVertexValues,
+        const unsigned int* _elements, size_t _numElements,
+        const AttributeLayout& _attributeLayout) :
+        vao(0), vbo(0), ebo(0), vertexHeap(nullptr), indexHeap(nullptr),
+        vertexAllocation(BufferHeap::InvalidHandle), indexAllocation(BufferHeap::InvalidHandle),
+        vertexStride(CalculateStride(_attributeLayout)), vertexFormat(nullptr), attributeLayout(_attributeLayout)
     {
-        // Create Vertex Array Object
-        GL_CHECK(glGenVertexArrays(1, &vao));
-        GL_CHECK(glBindVertexArray(vao));
 
-        // Create a Vertex Buffer Object and copy the vertex data to it
-        GL_CHECK(glGenBuffers(1, &vbo));
+        if (Capabilities::DirectStateAccess())
+        {
+            // Create the buffers with immutable storage and attach them without disturbing the bound state.
+            // Immutable storage cannot be empty, so an empty buffer is left without any.
+            GL_CHECK(glCreateBuffers(1, &vbo));
+            if (_numVertexValues > 0)
+            {
+                GL_CHECK(glNamedBufferStorage(vbo, _numVertexValues * sizeof(float), _vertices, 0));
+            }
 
-        // Bind the Vertex Buffer to the Vertex Array
-        GL_CHECK(glBindBuffer(GL_ARRAY_BUFFER, vbo));
+            GL_CHECK(glCreateBuffers(1, &ebo));
+            if (_numElements > 0)
+            {
+                GL_CHECK(glNamedBufferStorage(ebo, _numElements * sizeof(GLuint), _elements, 0));
+            }
+        }
+        else
+        {
+            // Create a Vertex Buffer Object and copy the vertex data to it
+            GL_CHECK(glGenBuffers(1, &vbo));
 
-        // Move the vertex data into the vertex buffer (i.e. onto the graphics card)
-        GL_CHECK((glBufferData(GL_ARRAY_BUFFER, _vertices.size() * sizeof(float), &_vertices[0], GL_STATIC_DRAW)));
+            // Bind the Vertex Buffer, this is not part of any vertex array's state
+            GL_CHECK(glBindBuffer(GL_ARRAY_BUFFER, vbo));
 
-        // Generate an element buffer object (essitially a list 
-        glGenBuffers(1, &ebo);
+            // Move the vertex data into the vertex buffer (i.e. onto the graphics card)
+            GL_CHECK((glBufferData(GL_ARRAY_BUFFER, _numVertexValues * sizeof(float), _vertices, GL_STATIC_DRAW)));
+
+            // Generate an element buffer object (essitially a list 
+            glGenBuffers(1, &ebo);
+
+            // Upload through the array buffer binding too, binding the element buffer would
+            // change whichever vertex array is currently bound
+            glBindBuffer(GL_ARRAY_BUFFER, ebo);
+            glBufferData(GL_ARRAY_BUFFER, _numElements * sizeof(GLuint), _elements, GL_STATIC_DRAW);
+        }
+
+        numIndices = static_cast<int>(_numElements);
+    }
+
+    VertexArray::VertexArray(BufferHeap& _vertexHeap, BufferHeap& _indexHeap,
+        const float* _vertices, size_t _numVertexValues,
+        const unsigned int* _elements, size_t _numElements,
+        const AttributeLayout& _attributeLayout) :
+        vao(0), vbo(0), ebo(0), vertexHeap(&_vertexHeap), indexHeap(&_indexHeap),
+        vertexAllocation(BufferHeap::InvalidHandle), indexAllocation(BufferHeap::InvalidHandle),
+        vertexStride(CalculateStride(_attributeLayout)), vertexFormat(nullptr), attributeLayout(_attributeLayout)
+    {
+        if (vertexStride == 0)
+        {
+            std::cerr << "Vertex array attribute layout is empty" << std::endl;
+            throw std::runtime_error("VertexArray Error");
+        }
 
-        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo);
-        glBufferData(GL_ELEMENT_ARRAY_BUFFER, _elements.size() * sizeof(GLuint), &_elements[0], GL_STATIC_DRAW);
+        // Vertices are aligned to the stride so the offset is a whole number of vertices for glDrawElementsBaseVertex
+        vertexAllocation = _vertexHeap.Allocate(_numVertexValues * sizeof(float), vertexStride, _vertices);
+        try
+        {
+            indexAllocation = _indexHeap.Allocate(_numElements * sizeof(GLuint), sizeof(GLuint), _elements);
+        }
+        catch (...)
+        {
+            _vertexHeap.Free(vertexAllocation);
+            throw;
+        }
 
-        numIndices = _elements.size();
+        numIndices = static_cast<int>(_numElements);
     }
 
     VertexArray::~VertexArray()
     {
-        glDeleteBuffers(1, &ebo);
-        glDeleteBuffers(1, &vbo);
+        // The format may still have this vertex array's buffers bound and their names can be reused
+        if (vertexFormat)
+        {
+            vertexFormat->ForgetBuffers();
+        }
+
+        if (vertexHeap)
+        {
+            vertexHeap->Free(vertexAllocation);
+            indexHeap->Free(indexAllocation);
+        }
+        else
+        {
+            glDeleteBuffers(1, &ebo);
+            glDeleteBuffers(1, &vbo);
+        }
         glDeleteVertexArrays(1, &vao);
     }
 
     void VertexArray::Bind()
     {
-        GL_CHECK(glBindVertexArray(vao));
+        if (vertexFormat)
+        {
+            vertexFormat->Bind();
+            vertexFormat->BindBuffers(GetVertexBuffer(), GetElementBuffer());
+        }
+        else
+        {
+            BindOwnVertexArray();
+        }
+    }
+
+    void VertexArray::SetVertexFormat(VertexFormat* _vertexFormat)
+    {
+        if (_vertexFormat && _vertexFormat->GetStride() != vertexStride)
+        {
+            std::cerr << "Vertex format stride " << _vertexFormat->GetStride() << " does not match the vertex array stride "
+                << vertexStride << std::endl;
+            throw std::runtime_error("VertexArray Error");
+        }
+
+        // The old format may still have this vertex array's buffers bound, which would otherwise go
+        // unnoticed once they are deleted or their names reused
+        if (vertexFormat && vertexFormat != _vertexFormat)
+        {
+            vertexFormat->ForgetBuffers();
+        }
+
+        vertexFormat = _vertexFormat;
     }
 
     void VertexArray::Render()
     {
-        glDrawElements(GL_TRIANGLES, numIndices, GL_UNSIGNED_INT, 0);
+        if (vertexHeap)
+        {
+            // Offsets are looked up each draw because defragmenting the heap can move them
+            const void* firstIndex = reinterpret_cast<const void*>(static_cast<uintptr_t>(GetFirstIndex() * sizeof(GLuint)));
+            glDrawElementsBaseVertex(GL_TRIANGLES, numIndices, GL_UNSIGNED_INT, firstIndex, GetBaseVertex());
+        }
+        else
+        {
+            glDrawElements(GL_TRIANGLES, numIndices, GL_UNSIGNED_INT, 0);
+        }
+    }
+
+    void VertexArray::SpecifyAttributeLayout(const ShaderProgram& _shaderProgram)
+    {
+        if (vao == 0)
+        {
+            CreateOwnVertexArray();
+        }
+
+        // Attributes the shader does not use are skipped but still take up space in each vertex
+        GLuint offset = 0;
+        for (const auto& attributeAndNumValues : attributeLayout)
+        {
+            const GLint numValues = std::get<int>(attributeAndNumValues);
+            const GLint location = _shaderProgram.GetAttributeLocation(std::get<std::string>(attributeAndNumValues));
+            if (location != -1)
+            {
+                if (Capabilities::DirectStateAccess())
+                {
+                    // The buffer and stride were attached to binding 0 when the vertex array was created
+                    GL_CHECK(glEnableVertexArrayAttrib(vao, location));
+                    GL_CHECK(glVertexArrayAttribFormat(vao, location, numValues, GL_FLOAT, GL_FALSE, offset));
+                    GL_CHECK(glVertexArrayAttribBinding(vao, location, 0));
+                }
+                else
+                {
+                    BindOwnVertexArray();
+                    GL_CHECK(glBindBuffer(GL_ARRAY_BUFFER, GetVertexBuffer()));
+                    GL_CHECK(glEnableVertexAttribArray(location));
+                    GL_CHECK(glVertexAttribPointer(location, numValues, GL_FLOAT, GL_FALSE, vertexStride,
+                        reinterpret_cast<const void*>(static_cast<uintptr_t>(offset))));
+                }
+            }
+            offset += numValues * sizeof(GLfloat);
+        }
     }
 
     AttributeLayout VertexArray::GetAttributeLayout()
@@ -52,4 +194,62 @@ namespace GLW
         return attributeLayout;
     }
 
+    GLuint VertexArray::GetVertexBuffer() const
+    {
+        return vertexHeap ? vertexHeap->GetBuffer() : vbo;
+    }
+
+    GLuint VertexArray::GetElementBuffer() const
+    {
+        return indexHeap ? indexHeap->GetBuffer() : ebo;
+    }
+
+    void VertexArray::BindOwnVertexArray()
+    {
+        if (vao == 0)
+        {
+            CreateOwnVertexArray();
+        }
+
+        GL_CHECK(glBindVertexArray(vao));
+    }
+
+    void VertexArray::CreateOwnVertexArray()
+    {
+        // Heap allocated vertex arrays refer to the whole heap buffers, the attribute layout is
+        // specified relative to the start of the heap and offset by the base vertex
+        if (Capabilities::DirectStateAccess())
+        {
+            GL_CHECK(glCreateVertexArrays(1, &vao));
+            GL_CHECK(glVertexArrayVertexBuffer(vao, 0, GetVertexBuffer(), 0, vertexStride));
+            GL_CHECK(glVertexArrayElementBuffer(vao, GetElementBuffer()));
+        }
+        else
+        {
+            GL_CHECK(glGenVertexArrays(1, &vao));
+            GL_CHECK(glBindVertexArray(vao));
+            GL_CHECK(glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, GetElementBuffer()));
+        }
+    }
+
+    GLsizei VertexArray::CalculateStride(const AttributeLayout& _attributeLayout)
+    {
+        GLsizei stride = 0;
+        for (const auto& attributeAndNumValues : _attributeLayout)
+        {
+            stride += std::get<int>(attributeAndNumValues) * sizeof(GLfloat);
+        }
+        return stride;
+    }
+
+    GLuint VertexArray::GetFirstIndex() const
+    {
+        return vertexHeap ? static_cast<GLuint>(indexHeap->GetOffset(indexAllocation) / sizeof(GLuint)) : 0;
+    }
+
+    GLint VertexArray::GetBaseVertex() const
+    {
+        return vertexHeap ? static_cast<GLint>(vertexHeap->GetOffset(vertexAllocation) / vertexStride) : 0;
+    }
+
 }
\ No newline at end of file
@@ -0,0 +1,142 @@
+#include "GLW/VertexFormat.h"
+
+#include <tuple>
+
+namespace GLW
+{
+
+	bool VertexFormat::Attribute::operator<(const Attribute& _other) const
+	{
+		return std::tie(location, numValues, offset) < std::tie(_other.location, _other.numValues, _other.offset);
+	}
+
+	VertexFormat::VertexFormat(VertexFormatCache& _cache, const std::vector<Attribute>& _attributes, GLsizei _stride) :
+		cache(_cache), vao(0), stride(_stride), vertexBuffer(0), elementBuffer(0)
+	{
+		if (!IsSupported())
+		{
+			std::cerr << "Vertex formats need an OpenGL 4.3 context" << std::endl;
+			throw std::runtime_error("VertexFormat Error");
+		}
+
+		if (Capabilities::DirectStateAccess())
+		{
+			GL_CHECK(glCreateVertexArrays(1, &vao));
+			for (const auto& attribute : _attributes)
+			{
+				GL_CHECK(glEnableVertexArrayAttrib(vao, attribute.location));
+				GL_CHECK(glVertexArrayAttribFormat(vao, attribute.location, attribute.numValues, GL_FLOAT, GL_FALSE, attribute.offset));
+				GL_CHECK(glVertexArrayAttribBinding(vao, attribute.location, BindingIndex));
+			}
+		}
+		else
+		{
+			GL_CHECK(glGenVertexArrays(1, &vao));
+			GL_CHECK(glBindVertexArray(vao));
+			for (const auto& attribute : _attributes)
+			{
+				GL_CHECK(glEnableVertexAttribArray(attribute.location));
+				GL_CHECK(glVertexAttribFormat(attribute.location, attribute.numValues, GL_FLOAT, GL_FALSE, attribute.offset));
+				GL_CHECK(glVertexAttribBinding(attribute.location, BindingIndex));
+			}
+			cache.boundFormat = this;
+		}
+	}
+
+	VertexFormat::~VertexFormat()
+	{
+		if (cache.boundFormat == this)
+		{
+			cache.boundFormat = nullptr;
+		}
+		glDeleteVertexArrays(1, &vao);
+	}
+
+	void VertexFormat::Bind()
+	{
+		if (cache.boundFormat != this)
+		{
+			GL_CHECK(glBindVertexArray(vao));
+			cache.boundFormat = this;
+		}
+	}
+
+	void VertexFormat::BindBuffers(GLuint _vertexBuffer, GLuint _elementBuffer)
+	{
+		if (_vertexBuffer != vertexBuffer)
+		{
+			GL_CHECK(glBindVertexBuffer(BindingIndex, _vertexBuffer, 0, stride));
+			vertexBuffer = _vertexBuffer;
+		}
+
+		// The element buffer binding is part of the vertex array's state
+		if (_elementBuffer != elementBuffer)
+		{
+			GL_CHECK(glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, _elementBuffer));
+			elementBuffer = _elementBuffer;
+		}
+	}
+
+	void VertexFormat::ForgetBuffers()
+	{
+		vertexBuffer = 0;
+		elementBuffer = 0;
+	}
+
+	bool VertexFormat::IsSupported()
+	{
+		return GLAD_GL_VERSION_4_3 || GLAD_GL_ARB_vertex_attrib_binding;
+	}
+
+	std::vector<VertexFormat::Attribute> VertexFormat::Resolve(const AttributeLayout& _attributeLayout,
+		const ShaderProgram& _shaderProgram, GLsizei& _stride)
+	{
+		std::vector<Attribute> attributes;
+
+		GLuint offset = 0;
+		for (const auto& attributeAndNumValues : _attributeLayout)
+		{
+			const GLint numValues = std::get<int>(attributeAndNumValues);
+			const GLint location = _shaderProgram.GetAttributeLocation(std::get<std::string>(attributeAndNumValues));
+			if (location != -1)
+			{
+				attributes.push_back({ static_cast<GLuint>(location), numValues, offset });
+			}
+			offset += numValues * sizeof(GLfloat);
+		}
+
+		_stride = static_cast<GLsizei>(offset);
+		return attributes;
+	}
+
+	VertexFormatCache::VertexFormatCache() :
+		boundFormat(nullptr)
+	{
+
+	}
+
+	VertexFormatCache::~VertexFormatCache()
+	{
+
+	}
+
+	VertexFormat& VertexFormatCache::Get(const AttributeLayout& _attributeLayout, const ShaderProgram& _shaderProgram)
+	{
+		Key key;
+		key.second = VertexFormat::Resolve(_attributeLayout, _shaderProgram, key.first);
+
+		auto format = formats.find(key);
+		if (format == formats.end())
+		{
+			format = formats.insert(std::make_pair(key, VertexFormat::Make(*this, key.second, key.first))).first;
+		}
+
+		return *format->second;
+	}
+
+	void VertexFormatCache::ForgetBinding()
+	{
+		boundFormat = nullptr;
+	}
+
+} // namespace GLW
@@ -0,0 +1,279 @@
+// File: MeshConverter.cpp
+// Author: Rowan Clark
+//
+// Description:
+// Offline tool which converts Wavefront OBJ files into GLW binary mesh files
+// (see GLW/MeshFile.h). Each input file becomes one level of detail, the first
+// being the full detail mesh. Faces are triangulated and vertices which share
+// position, texture coordinate and normal are welded together.
+//
+// The vertex layout is position (3), then normal (3) and texture coordinate (2)
+// if the first input has them. The error stored for each level of detail is the
+// fraction of the full detail triangles it removes.
+//
+// ---- Usage ----
+//
+//    MeshConverter [--position name] [--normal name] [--texcoords name] output.glwm lod0.obj [lod1.obj ...]
+
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <tuple>
+#include <vector>
+
+#include "GLW/MeshFile.h"
+
+namespace
+{
+	struct ObjMesh
+	{
+		std::vector<float> positions;
+		std::vector<float> texCoords;
+		std::vector<float> normals;
+		// Position, texture coordinate and normal indices per corner, -1 where absent
+		std::vector<std::tuple<int, int, int>> corners;
+	};
+
+	// OBJ indices are 1 based, negative indices count back from the end
+	int ResolveIndex(const std::string& _token, size_t _count)
+	{
+		if (_token.empty())
+		{
+			return -1;
+		}
+
+		int index = std::atoi(_token.c_str());
+		int resolved = (index < 0) ? static_cast<int>(_count) + index : index - 1;
+		if (resolved < 0 || resolved >= static_cast<int>(_count))
+		{
+			throw std::runtime_error("OBJ index out of range: " + _token);
+		}
+		return resolved;
+	}
+
+	ObjMesh LoadObj(const std::string& _path)
+	{
+		std::ifstream file(_path);
+		if (!file)
+		{
+			throw std::runtime_error("Could not open " + _path);
+		}
+
+		ObjMesh mesh;
+		std::string line;
+		while (std::getline(file, line))
+		{
+			std::istringstream stream(line);
+			std::string type;
+			stream >> type;
+
+			if (type == "v" || type == "vn")
+			{
+				float x = 0.0f, y = 0.0f, z = 0.0f;
+				stream >> x >> y >> z;
+				std::vector<float>& target = (type == "v") ? mesh.positions : mesh.normals;
+				target.insert(target.end(), { x, y, z });
+			}
+			else if (type == "vt")
+			{
+				float u = 0.0f, v = 0.0f;
+				stream >> u >> v;
+				mesh.texCoords.insert(mesh.texCoords.end(), { u, v });
+			}
+			else if (type == "f")
+			{
+				std::vector<std::tuple<int, int, int>> face;
+				std::string vertex;
+				while (stream >> vertex)
+				{
+					// v, v/vt, v//vn or v/vt/vn
+					std::string tokens[3];
+					std::istringstream vertexStream(vertex);
+					for (int i = 0; i < 3 && std::getline(vertexStream, tokens[i], '/'); ++i)
+					{
+					}
+
+					if (tokens[0].empty())
+					{
+						throw std::runtime_error("Face vertex without a position in " + _path + ": " + vertex);
+					}
+
+					face.push_back(std::make_tuple(
+						ResolveIndex(tokens[0], mesh.positions.size() / 3),
+						ResolveIndex(tokens[1], mesh.texCoords.size() / 2),
+						ResolveIndex(tokens[2], mesh.normals.size() / 3)));
+				}
+
+				// Triangulate as a fan
+				for (size_t i = 2; i < face.size(); ++i)
+				{
+					mesh.corners.push_back(face[0]);
+					mesh.corners.push_back(face[i - 1]);
+					mesh.corners.push_back(face[i]);
+				}
+			}
+		}
+
+		if (mesh.corners.empty())
+		{
+			throw std::runtime_error(_path + " contains no faces");
+		}
+
+		return mesh;
+	}
+
+	GLW::MeshLodData BuildLod(const ObjMesh& _mesh, bool _hasNormals, bool _hasTexCoords)
+	{
+		GLW::MeshLodData lod;
+		lod.error = 0.0f;
+
+		std::map<std::tuple<int, int, int>, unsigned int> welded;
+		for (const auto& corner : _mesh.corners)
+		{
+			auto found = welded.find(corner);
+			if (found != welded.end())
+			{
+				lod.indices.push_back(found->second);
+				continue;
+			}
+
+			int position = std::get<0>(corner);
+			int texCoord = std::get<1>(corner);
+			int normal = std::get<2>(corner);
+
+			lod.vertices.insert(lod.vertices.end(), &_mesh.positions[position * 3], &_mesh.positions[position * 3] + 3);
+			if (_hasNormals)
+			{
+				if (normal < 0)
+				{
+					lod.vertices.insert(lod.vertices.end(), { 0.0f, 0.0f, 0.0f });
+				}
+				else
+				{
+					lod.vertices.insert(lod.vertices.end(), &_mesh.normals[normal * 3], &_mesh.normals[normal * 3] + 3);
+				}
+			}
+			if (_hasTexCoords)
+			{
+				if (texCoord < 0)
+				{
+					lod.vertices.insert(lod.vertices.end(), { 0.0f, 0.0f });
+				}
+				else
+				{
+					lod.vertices.insert(lod.vertices.end(), &_mesh.texCoords[texCoord * 2], &_mesh.texCoords[texCoord * 2] + 2);
+				}
+			}
+
+			unsigned int index = static_cast<unsigned int>(welded.size());
+			welded[corner] = index;
+			lod.indices.push_back(index);
+		}
+
+		return lod;
+	}
+
+	void PrintUsage()
+	{
+		std::cerr << "Usage: MeshConverter [--position name] [--normal name] [--texcoords name] "
+			"output.glwm lod0.obj [lod1.obj ...]" << std::endl;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	std::string positionName = "position";
+	std::string normalName = "normal";
+	std::string texCoordName = "texCoords";
+	std::vector<std::string> paths;
+
+	for (int i = 1; i < argc; ++i)
+	{
+		std::string argument = argv[i];
+		if ((argument == "--position" || argument == "--normal" || argument == "--texcoords") && i + 1 < argc)
+		{
+			std::string& name = (argument == "--position") ? positionName : (argument == "--normal") ? normalName : texCoordName;
+			name = argv[++i];
+		}
+		else if (argument.compare(0, 2, "--") == 0)
+		{
+			PrintUsage();
+			return EXIT_FAILURE;
+		}
+		else
+		{
+			paths.push_back(argument);
+		}
+	}
+
+	if (paths.size() < 2)
+	{
+		PrintUsage();
+		return EXIT_FAILURE;
+	}
+
+	try
+	{
+		std::vector<ObjMesh> meshes;
+		for (size_t i = 1; i < paths.size(); ++i)
+		{
+			std::cout << "Reading " << paths[i] << std::endl;
+			meshes.push_back(LoadObj(paths[i]));
+		}
+
+		// Every level of detail shares the layout of the full detail mesh
+		const bool hasNormals = !meshes[0].normals.empty();
+		const bool hasTexCoords = !meshes[0].texCoords.empty();
+
+		GLW::AttributeLayout attributeLayout = { std::make_tuple(positionName, 3) };
+		if (hasNormals)
+		{
+			attributeLayout.push_back(std::make_tuple(normalName, 3));
+		}
+		if (hasTexCoords)
+		{
+			attributeLayout.push_back(std::make_tuple(texCoordName, 2));
+		}
+
+		std::vector<GLW::MeshLodData> lods;
+		for (const auto& mesh : meshes)
+		{
+			lods.push_back(BuildLod(mesh, hasNormals, hasTexCoords));
+			lods.back().error = 1.0f - float(lods.back().indices.size()) / float(lods.front().indices.size());
+		}
+
+		// Bounds of the full detail positions, which are the first three floats of each vertex
+		const size_t stride = 3 + (hasNormals ? 3 : 0) + (hasTexCoords ? 2 : 0);
+		const std::vector<float>& vertices = lods[0].vertices;
+		glm::vec3 boundsMin(vertices[0], vertices[1], vertices[2]);
+		glm::vec3 boundsMax = boundsMin;
+		for (size_t i = 0; i < vertices.size(); i += stride)
+		{
+			for (int axis = 0; axis < 3; ++axis)
+			{
+				boundsMin[axis] = std::min(boundsMin[axis], vertices[i + axis]);
+				boundsMax[axis] = std::max(boundsMax[axis], vertices[i + axis]);
+			}
+		}
+
+		GLW::MeshFile::Write(paths[0], attributeLayout, boundsMin, boundsMax, lods);
+
+		for (size_t i = 0; i < lods.size(); ++i)
+		{
+			std::cout << "LOD " << i << ": " << lods[i].vertices.size() / stride << " vertices, "
+				<< lods[i].indices.size() / 3 << " triangles" << std::endl;
+		}
+		std::cout << "Wrote " << paths[0] << std::endl;
+	}
+	catch (std::exception& e)
+	{
+		std::cerr << "Error: " << e.what() << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,309 @@
+// File: TraceReplay.cpp
+// Author: Rowan Clark
+//
+// Description:
+// Offline tool which replays a GLW trace (see GLW/TracePlayer.h) in a
+// headless EGL context and reports how long each frame took, so changes to
+// GLW can be measured against recorded workloads. It is intended to be run
+// on Mesa's llvmpipe (e.g. LIBGL_ALWAYS_SOFTWARE=1) so results do not depend
+// on the graphics card of the machine running it.
+//
+// CPU time is the time spent making the frame's GlWrap calls. GPU time comes
+// from a GL_TIME_ELAPSED query around the frame; queries are read a few
+// frames later so waiting for them does not serialise the CPU and GPU.
+// The first frames of a trace usually create and upload every resource, so
+// they are listed but left out of the summary (see --skip).
+//
+// The tool creates its context through EGL so it only builds on Linux, where
+// it is compiled directly against the GLW sources rather than through the
+// Visual Studio solution. From the repository root, with glad's generated
+// glad.c, SOIL and glm available:
+//
+//    g++ -std=c++14 -O2 -IGLW/include -o TraceReplay TraceReplay/src/TraceReplay.cpp GLW/src/*.cpp glad.c -lSOIL -lEGL -lGL -lpthread -ldl
+//
+// ---- Usage ----
+//
+//    TraceReplay [--width pixels] [--height pixels] [--skip frames] [--csv output.csv] capture.glwt
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+
+#include "GLW/TracePlayer.h"
+
+namespace
+{
+	struct FrameTiming
+	{
+		double cpuMilliseconds;
+		double gpuMilliseconds;
+	};
+
+	// A pbuffer backed context, so nothing needs a window or display server
+	class HeadlessContext
+	{
+	public:
+		HeadlessContext(int _width, int _height) :
+			display(EGL_NO_DISPLAY), surface(EGL_NO_SURFACE), context(EGL_NO_CONTEXT)
+		{
+			// Prefer Mesa's surfaceless platform, which works without X or Wayland
+			auto getPlatformDisplay = reinterpret_cast<PFNEGLGETPLATFORMDISPLAYEXTPROC>(eglGetProcAddress("eglGetPlatformDisplayEXT"));
+			if (getPlatformDisplay)
+			{
+				display = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr);
+			}
+			if (display == EGL_NO_DISPLAY)
+			{
+				display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+			}
+
+			EGLint major, minor;
+			if (display == EGL_NO_DISPLAY || !eglInitialize(display, &major, &minor))
+			{
+				throw std::runtime_error("Could not initialise EGL");
+			}
+
+			const EGLint configAttributes[] =
+			{
+				EGL_SURFACE_TYPE, EGL_PBUFFER_BIT,
+				EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+				EGL_RED_SIZE, 8, EGL_GREEN_SIZE, 8, EGL_BLUE_SIZE, 8, EGL_ALPHA_SIZE, 8,
+				EGL_DEPTH_SIZE, 24,
+				EGL_NONE
+			};
+			EGLConfig config;
+			EGLint numConfigs = 0;
+			if (!eglChooseConfig(display, configAttributes, &config, 1, &numConfigs) || numConfigs == 0)
+			{
+				throw std::runtime_error("No EGL config supports desktop OpenGL pbuffers");
+			}
+
+			const EGLint surfaceAttributes[] = { EGL_WIDTH, _width, EGL_HEIGHT, _height, EGL_NONE };
+			surface = eglCreatePbufferSurface(display, config, surfaceAttributes);
+			if (surface == EGL_NO_SURFACE)
+			{
+				throw std::runtime_error("Could not create an EGL pbuffer");
+			}
+
+			eglBindAPI(EGL_OPENGL_API);
+
+			// Ask for the newest core context first so the replay takes the same code paths as the capture would
+			const EGLint versions[][2] = { { 4, 6 }, { 4, 5 }, { 4, 3 }, { 3, 3 } };
+			for (const auto& version : versions)
+			{
+				const EGLint contextAttributes[] =
+				{
+					EGL_CONTEXT_MAJOR_VERSION, version[0],
+					EGL_CONTEXT_MINOR_VERSION, version[1],
+					EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+					EGL_NONE
+				};
+				context = eglCreateContext(display, config, EGL_NO_CONTEXT, contextAttributes);
+				if (context != EGL_NO_CONTEXT)
+				{
+					break;
+				}
+			}
+			if (context == EGL_NO_CONTEXT || !eglMakeCurrent(display, surface, surface, context))
+			{
+				throw std::runtime_error("Could not create an OpenGL 3.3 or later core context");
+			}
+
+			if (!gladLoadGLLoader(reinterpret_cast<GLADloadproc>(eglGetProcAddress)))
+			{
+				throw std::runtime_error("Could not load OpenGL functions");
+			}
+		}
+
+		~HeadlessContext()
+		{
+			eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+			if (context != EGL_NO_CONTEXT)
+			{
+				eglDestroyContext(display, context);
+			}
+			if (surface != EGL_NO_SURFACE)
+			{
+				eglDestroySurface(display, surface);
+			}
+			eglTerminate(display);
+		}
+
+	private:
+		EGLDisplay display;
+		EGLSurface surface;
+		EGLContext context;
+	};
+
+	double Percentile(std::vector<double> _values, double _percentile)
+	{
+		if (_values.empty())
+		{
+			return 0.0;
+		}
+		std::sort(_values.begin(), _values.end());
+		size_t index = static_cast<size_t>(_percentile * (_values.size() - 1) + 0.5);
+		return _values[index];
+	}
+
+	void PrintSummary(const std::string& _name, const std::vector<double>& _values)
+	{
+		double total = 0.0;
+		for (double value : _values)
+		{
+			total += value;
+		}
+
+		std::cout << std::fixed << std::setprecision(3) << _name
+			<< " ms: mean " << (_values.empty() ? 0.0 : total / _values.size())
+			<< ", median " << Percentile(_values, 0.5)
+			<< ", p95 " << Percentile(_values, 0.95)
+			<< ", max " << Percentile(_values, 1.0) << std::endl;
+	}
+
+	void PrintUsage()
+	{
+		std::cerr << "Usage: TraceReplay [--width pixels] [--height pixels] [--skip frames] [--csv output.csv] "
+			"capture.glwt" << std::endl;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	int width = 1280;
+	int height = 720;
+	size_t skipFrames = 1;
+	std::string csvPath;
+	std::string tracePath;
+
+	for (int i = 1; i < argc; ++i)
+	{
+		std::string argument = argv[i];
+		if ((argument == "--width" || argument == "--height" || argument == "--skip") && i + 1 < argc)
+		{
+			int value = std::atoi(argv[++i]);
+			if (argument == "--width") width = value;
+			else if (argument == "--height") height = value;
+			else skipFrames = static_cast<size_t>(std::max(value, 0));
+		}
+		else if (argument == "--csv" && i + 1 < argc)
+		{
+			csvPath = argv[++i];
+		}
+		else if (argument.compare(0, 2, "--") == 0 || !tracePath.empty())
+		{
+			PrintUsage();
+			return EXIT_FAILURE;
+		}
+		else
+		{
+			tracePath = argument;
+		}
+	}
+
+	if (tracePath.empty() || width <= 0 || height <= 0)
+	{
+		PrintUsage();
+		return EXIT_FAILURE;
+	}
+
+	try
+	{
+		HeadlessContext headlessContext(width, height);
+		std::cout << "Replaying " << tracePath << " on " << glGetString(GL_RENDERER)
+			<< " (" << glGetString(GL_VERSION) << ")" << std::endl;
+
+		std::vector<FrameTiming> timings;
+		{
+			GLW::TracePlayer player(tracePath);
+
+			// Enough queries in flight that reading the oldest one rarely has to wait
+			const size_t numQueries = 4;
+			GLuint queries[numQueries];
+			glGenQueries(numQueries, queries);
+
+			auto readQuery = [&](size_t _frame)
+			{
+				GLuint64 nanoseconds = 0;
+				glGetQueryObjectui64v(queries[_frame % numQueries], GL_QUERY_RESULT, &nanoseconds);
+				timings[_frame].gpuMilliseconds = nanoseconds / 1.0e6;
+			};
+
+			for (size_t frame = 0;; ++frame)
+			{
+				if (frame >= numQueries)
+				{
+					readQuery(frame - numQueries);
+				}
+
+				glBeginQuery(GL_TIME_ELAPSED, queries[frame % numQueries]);
+				auto start = std::chrono::steady_clock::now();
+				bool replayed = player.ReplayFrame();
+				auto stop = std::chrono::steady_clock::now();
+				glEndQuery(GL_TIME_ELAPSED);
+
+				if (!replayed)
+				{
+					break;
+				}
+
+				glFlush();
+				timings.push_back({ std::chrono::duration<double, std::milli>(stop - start).count(), 0.0 });
+			}
+
+			// The final pass through the loop found the end of the trace after beginning a query in
+			// the slot of the frame numQueries back, which it had already read, so only the frames
+			// after that one are outstanding
+			glFinish();
+			for (size_t frame = timings.size() >= numQueries ? timings.size() - (numQueries - 1) : 0; frame < timings.size(); ++frame)
+			{
+				readQuery(frame);
+			}
+			glDeleteQueries(numQueries, queries);
+
+			std::cout << "Replayed " << player.GetNumFramesReplayed() << " frames, "
+				<< player.GetNumCommandsReplayed() << " commands" << std::endl;
+		}
+
+		if (!csvPath.empty())
+		{
+			std::ofstream csv(csvPath);
+			csv << "frame,cpu_ms,gpu_ms\n";
+			for (size_t frame = 0; frame < timings.size(); ++frame)
+			{
+				csv << frame << "," << timings[frame].cpuMilliseconds << "," << timings[frame].gpuMilliseconds << "\n";
+			}
+			if (!csv)
+			{
+				throw std::runtime_error("Could not write " + csvPath);
+			}
+		}
+
+		std::vector<double> cpu, gpu;
+		for (size_t frame = skipFrames; frame < timings.size(); ++frame)
+		{
+			cpu.push_back(timings[frame].cpuMilliseconds);
+			gpu.push_back(timings[frame].gpuMilliseconds);
+		}
+
+		std::cout << "Summary of " << cpu.size() << " frames after skipping " << std::min(skipFrames, timings.size()) << std::endl;
+		PrintSummary("CPU", cpu);
+		PrintSummary("GPU", gpu);
+	}
+	catch (std::exception& e)
+	{
+		std::cerr << "Error: " << e.what() << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	return EXIT_SUCCESS;
+}